@@ -0,0 +1,124 @@
+// File FLP_Benchmark.cc
+// the scaling benchmark: for each size (customers x facilities) an instance is generated (FLP_Generator.hh)
+// with the other features at their defaults, and loaded and searched in a child process, so that the peak
+// memory of each size is measured separately; a JSON object per size is printed on stdout, with the load
+// time, the memory after the load and at the end, and the iterations per second of CSKSA at its start
+// temperature (max_iterations = neighbors_sampled = iterations)
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "FLP_Generator.hh"
+#include "FLP_Solver.hh"
+
+namespace
+{
+  double Seconds(chrono::steady_clock::time_point start)
+  { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); }
+
+  void Measure(const string& file_name, const string& prefix, unsigned long iterations, unsigned seed, bool sparse_costs)
+  { // in the child process
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    FLP_Input in(file_name, 1.375, 8, sparse_costs);
+    double load_time = Seconds(start), load_memory = PeakResidentMemory();
+    FLP_Options options;
+    options.random_seed = false;
+    options.seed = seed;
+    options.runner_arguments = {"--CSKSA::max_iterations", to_string(iterations), "--CSKSA::neighbors_sampled", to_string(iterations)};
+    FLP_Solver solver(in, options);
+    FLP_Result result = solver.Solve();
+    cout << prefix << "\"load_time\": " << load_time << ", "
+         << "\"load_memory\": " << load_memory << ", "
+         << "\"init_time\": " << result.init_time << ", "
+         << "\"search_time\": " << result.time << ", "
+         << "\"iterations_per_second\": " << (result.time > 0.0 ? iterations / result.time : 0.0) << ", "
+         << "\"cost\": " << result.cost << ", "
+         << "\"peak_memory\": " << PeakResidentMemory() << "}" << endl;
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  vector<pair<int,int>> sizes = {{1000, 400}, {2000, 800}, {4000, 1600}, {8000, 3200}};
+  unsigned long iterations = 100000;
+  unsigned seed = 0;
+  string directory = "/tmp";
+  bool sparse_costs = false, keep = false;
+  int i, status;
+  char x;
+  pid_t pid;
+  for (i = 1; i < argc; i++)
+    {
+      string option = argv[i];
+      if (option == "--sparse_costs")
+        sparse_costs = true;
+      else if (option == "--keep")
+        keep = true;
+      else if (i + 1 < argc && option == "--iterations")
+        iterations = stoul(argv[++i]);
+      else if (i + 1 < argc && option == "--seed")
+        seed = stoul(argv[++i]);
+      else if (i + 1 < argc && option == "--directory")
+        directory = argv[++i];
+      else if (i + 1 < argc && option == "--sizes")
+        { // e.g. 1000x400,2000x800
+          istringstream is(argv[++i]);
+          pair<int,int> size;
+          sizes.clear();
+          while (is >> size.first >> x >> size.second)
+            {
+              sizes.push_back(size);
+              is >> x;
+            }
+        }
+      else
+        {
+          cerr << "Usage: " << argv[0] << " [--sizes <S>x<W>,...] [--iterations <n>] [--seed <n>] [--directory <dir>] "
+               << "[--sparse_costs] [--keep]" << endl;
+          return 1;
+        }
+    }
+  for (const pair<int,int>& size : sizes)
+    {
+      string file_name = directory + "/flp_benchmark_" + to_string(size.first) + "x" + to_string(size.second) + ".dzn";
+      ostringstream prefix;
+      FLP_GeneratorParameters p;
+      p.customers = size.first;
+      p.facilities = size.second;
+      p.seed = seed;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      try
+        {
+          FLP_Generator generator(p);
+          ofstream os(file_name.c_str());
+          generator.Write(os);
+          if (!os)
+            {
+              cerr << "Cannot write the instance " << file_name << endl;
+              return 1;
+            }
+          prefix << "{\"customers\": " << size.first << ", \"facilities\": " << size.second << ", "
+                 << "\"incompatibilities\": " << generator.Incompatibilities() << ", "
+                 << "\"generation_time\": " << Seconds(start) << ", ";
+        }
+      catch (const invalid_argument& e)
+        {
+          cerr << e.what() << endl;
+          return 1;
+        }
+      cout.flush();
+      pid = fork();
+      if (pid == 0)
+        {
+          Measure(file_name, prefix.str(), iterations, seed, sparse_costs);
+          _exit(0);
+        }
+      if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        cerr << "The measure of " << file_name << " failed" << endl;
+      if (!keep)
+        remove(file_name.c_str());
+    }
+  return 0;
+}
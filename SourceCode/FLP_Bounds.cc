@@ -0,0 +1,192 @@
+// File FLP_Bounds.cc
+#include <cmath>
+#include <limits>
+#include "FLP_Bounds.hh"
+
+FLP_LagrangianBound::FLP_LagrangianBound(const FLP_Input& my_in, int max_it)
+  : in(my_in), max_iterations(max_it), lambda(in.Stores()), subgradient(in.Stores()), best_lambda(in.Stores()),
+    candidates(in.Warehouses()), value(in.Warehouses()), opening(in.Warehouses()),
+    dual_bound(0.0), reduced_cost(in.Warehouses()), critical_cost(in.Warehouses()),
+    bound(0), upper_bound(numeric_limits<CostType>::max()), iterations(0), stop(false)
+{}
+
+FLP_LagrangianBound::~FLP_LagrangianBound()
+{
+  Stop();
+}
+
+void FLP_LagrangianBound::Start(CostType ub)
+{
+  Stop();
+  stop = false;
+  worker = thread(&FLP_LagrangianBound::Run, this, ub);
+}
+
+void FLP_LagrangianBound::Stop()
+{
+  stop = true;
+  if (worker.joinable())
+    worker.join();
+}
+
+void FLP_LagrangianBound::Run(CostType ub)
+{ // subgradient optimization with Polyak step sizes: the step factor theta is halved
+  // whenever the function does not improve for a number of iterations
+  const int PATIENCE = 20;
+  const double MIN_THETA = 1E-4;
+  int s, w, non_improving = 0;
+  double l, best = -numeric_limits<double>::infinity(), theta = 2.0, norm, step;
+  CostType new_bound;
+
+  upper_bound = ub;
+  for (s = 0; s < in.Stores(); s++)
+    { // start from the cheapest supply cost plus the fixed cost amortized over the capacity
+      // (warehouses without capacity cannot supply anything)
+      lambda[s] = numeric_limits<double>::infinity();
+      for (w = 0; w < in.Warehouses(); w++)
+        if (in.Capacity(w) > 0)
+          lambda[s] = min(lambda[s], in.SupplyCost(s,w) + in.FixedCost(w)/static_cast<double>(in.Capacity(w)));
+      if (lambda[s] == numeric_limits<double>::infinity())
+        lambda[s] = 0.0;
+    }
+  best_lambda = lambda;
+  while (!stop && iterations < max_iterations && theta > MIN_THETA)
+    {
+      l = Evaluate();
+      iterations++;
+      if (l > best + 1E-9)
+        {
+          best = l;
+          best_lambda = lambda;
+          non_improving = 0;
+          new_bound = static_cast<CostType>(ceil(l - 1E-6)); // costs are integer
+          if (new_bound > bound)
+            bound = new_bound;
+        }
+      else if (++non_improving == PATIENCE)
+        {
+          theta /= 2;
+          non_improving = 0;
+        }
+      if (bound >= upper_bound)
+        break; // the best solution is optimal
+      norm = 0.0;
+      for (s = 0; s < in.Stores(); s++)
+        norm += subgradient[s] * subgradient[s];
+      if (norm == 0.0)
+        break; // the relaxed solution satisfies all demands: lambda is optimal
+      step = theta * (upper_bound - l) / norm;
+      for (s = 0; s < in.Stores(); s++)
+        lambda[s] += step * subgradient[s];
+    }
+}
+
+double FLP_LagrangianBound::Evaluate()
+{
+  int s, w, i, k, q, residual;
+  double r, lagrangian = 0.0, needed_capacity = 0.0;
+  vector<int> order;
+
+  for (w = 0; w < in.Warehouses(); w++)
+    candidates[w].clear();
+  for (s = 0; s < in.Stores(); s++)
+    {
+      lagrangian += lambda[s] * in.AmountOfGoods(s);
+      needed_capacity += in.AmountOfGoods(s);
+      subgradient[s] = in.AmountOfGoods(s);
+      for (w = 0; w < in.Warehouses(); w++)
+        {
+          r = in.SupplyCost(s,w) - lambda[s];
+          if (r < 0)
+            candidates[w].push_back(make_pair(r,s));
+        }
+    }
+
+  // continuous knapsack of each warehouse, assuming it open: the most negative reduced costs first
+  for (w = 0; w < in.Warehouses(); w++)
+    {
+      sort(candidates[w].begin(), candidates[w].end());
+      value[w] = in.FixedCost(w);
+      residual = in.Capacity(w);
+      for (i = 0; i < static_cast<int>(candidates[w].size()) && residual > 0; i++)
+        {
+          q = min(in.AmountOfGoods(candidates[w][i].second), residual);
+          value[w] += candidates[w][i].first * q;
+          residual -= q;
+        }
+      if (in.Capacity(w) > 0)
+        order.push_back(w);
+      else
+        opening[w] = 0.0;
+    }
+
+  // covering LP: open the warehouses with negative value, then the cheapest ones per unit of
+  // capacity (the last one fractionally) until the total demand is covered; the warehouses without
+  // capacity stay closed
+  sort(order.begin(), order.end(), [this](int w1, int w2)
+       { return value[w1]/in.Capacity(w1) < value[w2]/in.Capacity(w2); });
+  for (k = 0; k < static_cast<int>(order.size()); k++)
+    {
+      w = order[k];
+      if (value[w] < 0)
+        opening[w] = 1.0;
+      else if (needed_capacity > 0)
+        opening[w] = min(1.0, needed_capacity / in.Capacity(w));
+      else
+        opening[w] = 0.0;
+      lagrangian += opening[w] * value[w];
+      needed_capacity -= opening[w] * in.Capacity(w);
+    }
+
+  // subgradient: amount of goods minus the quantity supplied in the relaxed solution
+  for (w = 0; w < in.Warehouses(); w++)
+    if (opening[w] > 0)
+      {
+        residual = in.Capacity(w);
+        for (i = 0; i < static_cast<int>(candidates[w].size()) && residual > 0; i++)
+          {
+            s = candidates[w][i].second;
+            q = min(in.AmountOfGoods(s), residual);
+            subgradient[s] -= opening[w] * q;
+            residual -= q;
+          }
+      }
+  return lagrangian;
+}
+
+void FLP_LagrangianBound::ComputeReducedCosts()
+{ // LP duals of the relaxation at the best multipliers: critical_cost[w] (<= 0) is the reduced cost of 
+  // the store that saturates the capacity of w, mu (>= 0) the ratio of the warehouse that completes the 
+  // covering; any such values give a valid bound, also after forcing the value of a variable
+  int s, w, i, q, residual;
+  double mu = 0.0, needed_capacity = 0.0;
+
+  lambda = best_lambda;
+  Evaluate();
+  for (w = 0; w < in.Warehouses(); w++)
+    {
+      critical_cost[w] = 0.0;
+      residual = in.Capacity(w);
+      for (i = 0; i < static_cast<int>(candidates[w].size()) && residual > 0; i++)
+        {
+          q = min(in.AmountOfGoods(candidates[w][i].second), residual);
+          residual -= q;
+          if (residual == 0)
+            critical_cost[w] = candidates[w][i].first;
+        }
+      if (in.Capacity(w) > 0 && opening[w] > 0 && value[w] > 0)
+        mu = max(mu, value[w] / in.Capacity(w)); // the last warehouse of the covering has the largest ratio
+    }
+  dual_bound = 0.0;
+  for (s = 0; s < in.Stores(); s++)
+    {
+      dual_bound += best_lambda[s] * in.AmountOfGoods(s);
+      needed_capacity += in.AmountOfGoods(s);
+    }
+  dual_bound += mu * needed_capacity;
+  for (w = 0; w < in.Warehouses(); w++)
+    {
+      reduced_cost[w] = value[w] - mu * in.Capacity(w);
+      dual_bound += min(0.0, reduced_cost[w]);
+    }
+}
@@ -0,0 +1,48 @@
+// File FLP_Bounds.hh
+#ifndef FLP_BOUNDS_HH
+#define FLP_BOUNDS_HH
+#include <atomic>
+#include <thread>
+#include "FLP_Input.hh"
+
+using namespace std;
+
+class FLP_LagrangianBound
+{ // Lagrangian relaxation of the demand constraints, solved by subgradient optimization:
+  // for given multipliers lambda the problem decomposes into one continuous knapsack per
+  // warehouse (capacity, and at most the amount of goods of each store), linked by the
+  // covering constraint on the total capacity of the open warehouses (solved as an LP);
+  // the two-supplier and the incompatibility constraints are relaxed
+public:
+  FLP_LagrangianBound(const FLP_Input& in, int max_iterations = 2000);
+  ~FLP_LagrangianBound();
+  void Start(CostType upper_bound); // run in a background thread
+  void Stop();
+  void Run(CostType upper_bound); // run in the calling thread (until convergence or Stop)
+  void SetUpperBound(CostType ub) { upper_bound = ub; } // the cost of the best solution found so far
+  CostType Bound() const { return bound; } // best bound computed so far (0 before the first iteration)
+  int Iterations() const { return iterations; }
+  // reduced-cost tests at the best multipliers (available after ComputeReducedCosts): lower bounds of 
+  // the cost of the solutions in which w is open, w is closed, and s is supplied (also) by w
+  void ComputeReducedCosts();
+  double OpenBound(int w) const { return dual_bound + max(0.0, reduced_cost[w]); }
+  double CloseBound(int w) const { return dual_bound - min(0.0, reduced_cost[w]); }
+  double ArcBound(int s, int w) const 
+  { return OpenBound(w) + max(0.0, in.SupplyCost(s,w) - best_lambda[s] - critical_cost[w]); }
+private:
+  double Evaluate(); // value of the Lagrangian function at lambda, setting the subgradient
+  const FLP_Input& in;
+  int max_iterations;
+  vector<double> lambda, subgradient, best_lambda;
+  vector<vector<pair<double,int>>> candidates; // for each warehouse, stores with negative reduced cost
+  vector<double> value; // optimal value of the subproblem of each warehouse
+  vector<double> opening; // opening variables of the covering LP
+  double dual_bound; // bound at best_lambda given by the LP duals below
+  vector<double> reduced_cost; // of the opening variable of each warehouse
+  vector<double> critical_cost; // dual of the capacity in the knapsack of each warehouse
+  atomic<CostType> bound, upper_bound;
+  atomic<int> iterations;
+  atomic<bool> stop;
+  thread worker;
+};
+#endif
@@ -0,0 +1,262 @@
+// File FLP_Checkpoint.cc
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "FLP_Checkpoint.hh"
+
+static const char CHECKPOINT_MAGIC[8] = {'F','L','P','C','K','P','T','2'};
+
+void FLP_Checkpoint::Take(const FLP_Input& in, const FLP_Output& current_state, const FLP_Output& best_state)
+{ // the order of the clients depends on the history of the state, and it is saved as well
+  int s, w, i;
+  current.resize(in.Stores());
+  best.resize(in.Stores());
+  clients.resize(in.Warehouses());
+  for (s = 0; s < in.Stores(); s++)
+    {
+      current[s] = current_state.Assignment(s);
+      best[s] = best_state.Assignment(s);
+    }
+  for (w = 0; w < in.Warehouses(); w++)
+    {
+      clients[w].resize(current_state.Clients(w));
+      for (i = 0; i < current_state.Clients(w); i++)
+        clients[w][i] = current_state.Client(w,i);
+    }
+}
+
+void FLP_Checkpoint::Restore(const FLP_Input& in, FLP_Output& current_state, FLP_Output& best_state) const
+{
+  int s, w;
+  if (static_cast<int>(current.size()) != in.Stores() || static_cast<int>(clients.size()) != in.Warehouses())
+    throw invalid_argument("The checkpoint is for an instance with " + to_string(current.size()) + " stores and "
+                           + to_string(clients.size()) + " warehouses");
+  for (const vector<Suppliers>* states : {&current, &best})
+    for (const Suppliers& sup : *states)
+      if (sup.w1 < 0 || sup.w1 >= in.Warehouses() || sup.w2 < -1 || sup.w2 >= in.Warehouses())
+        throw invalid_argument("The checkpoint is for a different instance");
+  for (s = 0; s < in.Stores(); s++)
+    { // the loads are checked as in the readers of the solutions
+      current_state.CheckQuantity(current[s].w1, current[s].q1);
+      current_state.AssignFirst(s, current[s].w1, current[s].q1);
+      if (current[s].w2 != -1)
+        {
+          current_state.CheckQuantity(current[s].w2, current[s].q2);
+          current_state.AssignSecond(s, current[s].w2, current[s].q2);
+        }
+      best_state.CheckQuantity(best[s].w1, best[s].q1);
+      best_state.AssignFirst(s, best[s].w1, best[s].q1);
+      if (best[s].w2 != -1)
+        {
+          best_state.CheckQuantity(best[s].w2, best[s].q2);
+          best_state.AssignSecond(s, best[s].w2, best[s].q2);
+        }
+    }
+  for (w = 0; w < in.Warehouses(); w++)
+    {
+      if (static_cast<int>(clients[w].size()) != current_state.Clients(w))
+        throw invalid_argument("Inconsistent clients of warehouse " + to_string(w) + " in the checkpoint");
+      current_state.SetClientOrder(w, clients[w]);
+    }
+}
+
+string FLP_Checkpoint::Encode() const
+{ // magic, method, seed, instance and preprocessing, counters, times, numbers of stores and of warehouses,
+  // the current and the best assignments, and the clients of the warehouses (each list preceded by its size)
+  string data;
+  auto put = [&data](const void* p, size_t n) { data.append(static_cast<const char*>(p), n); };
+  uint32_t length = method.size(), stores = current.size(), warehouses = clients.size(), size;
+  int32_t fields[4];
+  uint8_t flags = (renumber ? 1 : 0) | (reduce ? 2 : 0);
+  data.reserve(sizeof(CHECKPOINT_MAGIC) + method.size() + 64 + 2 * stores * sizeof(fields) + (warehouses + 2 * stores) * sizeof(size));
+  put(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  put(&length, sizeof(length));
+  put(method.data(), length);
+  put(&seed, sizeof(seed));
+  put(&instance, sizeof(instance));
+  put(&sqrt_ratio_preferred, sizeof(sqrt_ratio_preferred));
+  put(&cost_diff_threshold, sizeof(cost_diff_threshold));
+  put(&reduction_cost, sizeof(reduction_cost));
+  put(&flags, sizeof(flags));
+  put(&epoch, sizeof(epoch));
+  put(&iteration, sizeof(iteration));
+  put(&evaluations, sizeof(evaluations));
+  put(&temperature, sizeof(temperature));
+  put(&elapsed, sizeof(elapsed));
+  put(&remaining, sizeof(remaining));
+  put(&stores, sizeof(stores));
+  put(&warehouses, sizeof(warehouses));
+  for (const vector<Suppliers>* states : {&current, &best})
+    for (const Suppliers& sup : *states)
+      {
+        fields[0] = sup.w1;
+        fields[1] = sup.q1;
+        fields[2] = sup.w2;
+        fields[3] = sup.q2;
+        put(fields, sizeof(fields));
+      }
+  for (const vector<int>& list : clients)
+    {
+      size = list.size();
+      put(&size, sizeof(size));
+      put(list.data(), size * sizeof(int));
+    }
+  return data;
+}
+
+void FLP_Checkpoint::Decode(const string& data)
+{
+  size_t pos = 0;
+  auto get = [&data, &pos](void* p, size_t n)
+    {
+      if (pos + n > data.size())
+        throw invalid_argument("Truncated checkpoint");
+      memcpy(p, data.data() + pos, n);
+      pos += n;
+    };
+  char magic[sizeof(CHECKPOINT_MAGIC)];
+  uint32_t length, stores, warehouses, size;
+  int32_t fields[4];
+  uint8_t flags;
+  get(magic, sizeof(magic));
+  if (memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0)
+    throw invalid_argument("Not a checkpoint");
+  get(&length, sizeof(length));
+  if (length > data.size())
+    throw invalid_argument("Truncated checkpoint");
+  method.resize(length);
+  get(&method[0], length);
+  get(&seed, sizeof(seed));
+  get(&instance, sizeof(instance));
+  get(&sqrt_ratio_preferred, sizeof(sqrt_ratio_preferred));
+  get(&cost_diff_threshold, sizeof(cost_diff_threshold));
+  get(&reduction_cost, sizeof(reduction_cost));
+  get(&flags, sizeof(flags));
+  renumber = flags & 1;
+  reduce = flags & 2;
+  get(&epoch, sizeof(epoch));
+  get(&iteration, sizeof(iteration));
+  get(&evaluations, sizeof(evaluations));
+  get(&temperature, sizeof(temperature));
+  get(&elapsed, sizeof(elapsed));
+  get(&remaining, sizeof(remaining));
+  get(&stores, sizeof(stores));
+  get(&warehouses, sizeof(warehouses));
+  if (data.size() - pos < 2 * static_cast<size_t>(stores) * sizeof(fields) + warehouses * sizeof(size))
+    throw invalid_argument("Truncated checkpoint");
+  current.resize(stores);
+  best.resize(stores);
+  for (vector<Suppliers>* states : {&current, &best})
+    for (Suppliers& sup : *states)
+      {
+        get(fields, sizeof(fields));
+        if (fields[0] != static_cast<IndexType>(fields[0]) || fields[1] != static_cast<QuantityType>(fields[1])
+            || fields[2] != static_cast<IndexType>(fields[2]) || fields[3] != static_cast<QuantityType>(fields[3]))
+          throw invalid_argument("Malformed checkpoint (out of the layout of the solutions)");
+        sup.w1 = fields[0];
+        sup.q1 = fields[1];
+        sup.w2 = fields[2];
+        sup.q2 = fields[3];
+      }
+  clients.resize(warehouses);
+  for (vector<int>& list : clients)
+    {
+      get(&size, sizeof(size));
+      if (size > stores)
+        throw invalid_argument("Malformed checkpoint");
+      list.resize(size);
+      get(list.data(), size * sizeof(int));
+    }
+  if (pos != data.size())
+    throw invalid_argument("Malformed checkpoint");
+}
+
+FLP_CheckpointWriter::FLP_CheckpointWriter(const string& name)
+  : file_name(name), has_pending(false), quit(false), written(0)
+{
+  writer = thread(&FLP_CheckpointWriter::Run, this);
+}
+
+void FLP_CheckpointWriter::Finish()
+{
+  {
+    lock_guard<mutex> lock(m);
+    quit = true;
+  }
+  cv.notify_one();
+  if (writer.joinable())
+    writer.join();
+}
+
+void FLP_CheckpointWriter::Submit(string&& data)
+{
+  {
+    lock_guard<mutex> lock(m);
+    if (quit)
+      return;
+    pending = move(data);
+    has_pending = true;
+  }
+  cv.notify_one();
+}
+
+bool FLP_CheckpointWriter::WriteFile(const string& name, const string& data)
+{ // the data reach the disk (fsync) before the file is renamed over the previous checkpoint
+  size_t done = 0;
+  ssize_t n;
+  int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  while (done < data.size())
+    {
+      n = write(fd, data.data() + done, data.size() - done);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      done += n;
+    }
+  if (done < data.size() || fsync(fd) < 0)
+    {
+      close(fd);
+      return false;
+    }
+  return close(fd) == 0;
+}
+
+void FLP_CheckpointWriter::Run()
+{ // the data are swapped out of the lock, so the search never waits for the disk
+  string data;
+  const string temporary = file_name + ".tmp";
+  unique_lock<mutex> lock(m);
+  while (true)
+    {
+      cv.wait(lock, [this]() { return has_pending || quit; });
+      if (!has_pending)
+        return;
+      data.swap(pending);
+      has_pending = false;
+      lock.unlock();
+      if (WriteFile(temporary, data) && rename(temporary.c_str(), file_name.c_str()) == 0)
+        written++;
+      else
+        cerr << "Cannot write the checkpoint " << file_name << endl;
+      lock.lock();
+    }
+}
+
+FLP_Checkpoint ReadCheckpoint(const string& file_name)
+{
+  FLP_Checkpoint checkpoint;
+  ifstream is(file_name.c_str(), ios::binary);
+  if (!is)
+    throw invalid_argument("Cannot open the checkpoint " + file_name);
+  ostringstream data;
+  data << is.rdbuf();
+  checkpoint.Decode(data.str());
+  return checkpoint;
+}
@@ -0,0 +1,60 @@
+// File FLP_Checkpoint.hh
+#ifndef FLP_CHECKPOINT_HH
+#define FLP_CHECKPOINT_HH
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "FLP_Output.hh"
+
+struct FLP_Checkpoint
+{ // the state of an annealing run at the start of a temperature level (epoch); the generators are reseeded
+  // at each level from the seed and the epoch, so the run can continue as if it had not been interrupted
+  string method;
+  unsigned seed = 0;
+  // the instance (FLP_Input::Fingerprint, before the reduction) and its preprocessing: the ids and the
+  // preferred lists of the states depend on them
+  unsigned long long instance = 0;
+  double sqrt_ratio_preferred = 0.0;
+  int cost_diff_threshold = 0, reduction_cost = -1; // the cost used by the reduction (-1 if not reduced)
+  bool renumber = false, reduce = false;
+  unsigned long long epoch = 0, iteration = 0, evaluations = 0;
+  double temperature = 0.0;
+  double elapsed = 0.0; // running time of the search up to the checkpoint
+  double remaining = 0.0; // time budget left (CSKSAtb)
+  vector<Suppliers> current, best; // internal ids
+  vector<vector<int>> clients; // of each warehouse in the current state, in their order
+  void Take(const FLP_Input& in, const FLP_Output& current_state, const FLP_Output& best_state); // O(S)
+  // the states are rebuilt on outputs without assignments, in O(S) plus the incompatibilities of the stores;
+  // throws invalid_argument if the checkpoint does not fit the instance
+  void Restore(const FLP_Input& in, FLP_Output& current_state, FLP_Output& best_state) const;
+  // compact binary form (native byte order, 32-bit ids, quantities and counts)
+  string Encode() const;
+  void Decode(const string& data); // throws invalid_argument if the data are not a complete checkpoint
+};
+
+class FLP_CheckpointWriter
+{ // the checkpoints are written by a background thread, on a temporary file (synced) then renamed over the previous
+  // one, so that a preemption in the middle of a write leaves the last complete checkpoint; if the search
+  // submits faster than the disk writes, only the last checkpoint submitted is kept
+public:
+  FLP_CheckpointWriter(const string& file_name);
+  ~FLP_CheckpointWriter() { Finish(); }
+  void Submit(string&& data);
+  void Finish(); // the pending checkpoint is written before returning, the following ones are ignored
+  unsigned Written() const { return written; }
+private:
+  void Run();
+  static bool WriteFile(const string& name, const string& data);
+  string file_name, pending;
+  bool has_pending, quit;
+  atomic<unsigned> written;
+  mutex m;
+  condition_variable cv;
+  thread writer;
+};
+
+// reads a checkpoint written by FLP_CheckpointWriter (throws invalid_argument on failure)
+FLP_Checkpoint ReadCheckpoint(const string& file_name);
+#endif
@@ -0,0 +1,53 @@
+// File FLP_Client.cc
+// a minimal client of the server mode of flp (--main::serve <socket>): the requests (one JSON object per
+// line) are read from stdin and sent to the socket, and all the lines received are printed on stdout,
+// until the server closes the connection (after answering all the requests)
+#include <iostream>
+#include <string>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+int main(int argc, const char* argv[])
+{
+  sockaddr_un sa;
+  int fd;
+  string line;
+  char chunk[4096];
+  ssize_t n;
+  if (argc != 2)
+    {
+      cerr << "Usage: " << argv[0] << " <socket>" << endl;
+      return 1;
+    }
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  strncpy(sa.sun_path, argv[1], sizeof(sa.sun_path) - 1);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) < 0)
+    {
+      cerr << "Cannot connect to " << argv[1] << ": " << strerror(errno) << endl;
+      return 1;
+    }
+  thread sender([fd]()
+                { // the write side is closed at the end of stdin, so that the server sees the end of the requests
+                  string request;
+                  while (getline(cin, request))
+                    {
+                      request += "\n";
+                      if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) < 0)
+                        break;
+                    }
+                  shutdown(fd, SHUT_WR);
+                });
+  while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+    cout.write(chunk, n).flush();
+  sender.join();
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,322 @@
+// File FLP_Flow.cc
+#include <queue>
+#include <limits>
+#include <chrono>
+#include "FLP_Flow.hh"
+
+void FLP_MinCostFlow::Clear(int nodes)
+{
+  arcs.clear();
+  out_arcs.assign(nodes, vector<int>());
+  potential.assign(nodes, 0);
+  distance.resize(nodes);
+  current_arc.resize(nodes);
+  visited.assign(nodes, false);
+}
+
+int FLP_MinCostFlow::AddArc(int from, int to, int capacity, CostType cost)
+{
+  arcs.push_back(Arc{to, capacity, cost});
+  out_arcs[from].push_back(arcs.size() - 1);
+  arcs.push_back(Arc{from, 0, -cost});
+  out_arcs[to].push_back(arcs.size() - 1);
+  return arcs.size() - 2;
+}
+
+int FLP_MinCostFlow::Solve(int source, int sink, int required)
+{ // primal-dual: each phase computes the distances w.r.t. the reduced costs (non-negative thanks 
+  // to the potentials), then saturates all the shortest paths at once
+  const long long INFINITE = numeric_limits<long long>::max();
+  int v, flow = 0, pushed;
+  long long d, reduced_cost;
+  priority_queue<pair<long long,int>, vector<pair<long long,int>>, greater<pair<long long,int>>> queue;
+
+  while (flow < required)
+    {
+      fill(distance.begin(), distance.end(), INFINITE);
+      distance[source] = 0;
+      queue = decltype(queue)();
+      queue.push(make_pair(0LL,source));
+      while (!queue.empty())
+        {
+          d = queue.top().first;
+          v = queue.top().second;
+          queue.pop();
+          if (v == sink)
+            break; // the nodes not settled are not closer than the sink
+          if (d > distance[v])
+            continue;
+          for (int a : out_arcs[v])
+            if (arcs[a].capacity > 0)
+              {
+                reduced_cost = arcs[a].cost + potential[v] - potential[arcs[a].to];
+                if (d + reduced_cost < distance[arcs[a].to])
+                  {
+                    distance[arcs[a].to] = d + reduced_cost;
+                    queue.push(make_pair(distance[arcs[a].to],arcs[a].to));
+                  }
+              }
+        }
+      if (distance[sink] == INFINITE)
+        break;
+      for (v = 0; v < static_cast<int>(potential.size()); v++)
+        potential[v] += min(distance[v], distance[sink]);
+      fill(current_arc.begin(), current_arc.end(), 0);
+      while (flow < required && (pushed = Augment(source, sink, required - flow)) > 0)
+        flow += pushed;
+    }
+  return flow;
+}
+
+int FLP_MinCostFlow::Augment(int v, int sink, int limit)
+{ // depth-first search of a path of arcs with null reduced cost (current_arc skips the exhausted ones)
+  int a, u, pushed;
+  if (v == sink)
+    return limit;
+  visited[v] = true;
+  for (; current_arc[v] < static_cast<int>(out_arcs[v].size()); current_arc[v]++)
+    {
+      a = out_arcs[v][current_arc[v]];
+      u = arcs[a].to;
+      if (arcs[a].capacity > 0 && !visited[u] && arcs[a].cost + potential[v] - potential[u] == 0)
+        {
+          pushed = Augment(u, sink, min(limit, arcs[a].capacity));
+          if (pushed > 0)
+            {
+              arcs[a].capacity -= pushed;
+              arcs[a^1].capacity += pushed;
+              visited[v] = false;
+              return pushed;
+            }
+        }
+    }
+  visited[v] = false;
+  return 0;
+}
+
+FLP_SupplyPolisher::FLP_SupplyPolisher(const FLP_Input& my_in, int max_r)
+  : in(my_in), max_rounds(max_r), allowed(in.Stores()), first_arc(in.Stores() + 1), calls(0), improvements(0), time(0.0)
+{}
+
+bool FLP_SupplyPolisher::Polish(FLP_Output& out)
+{ // the stores whose optimal flow violates the side constraints lose the offending arcs (all but the 
+  // two largest flows, or the ones to warehouses that already supply incompatible stores), and the 
+  // flow is solved again, for at most max_rounds times
+  int s, i, k, rounds = 0;
+  vector<pair<int,int>> flows; // (quantity, warehouse) for the current store
+  vector<int> pending;
+  bool improved = false;
+  FLP_Output candidate(out);
+  chrono::time_point<chrono::steady_clock> start = chrono::steady_clock::now();
+
+  calls++;
+  for (s = 0; s < in.Stores(); s++)
+    {
+      allowed[s].clear();
+      for (i = 0; i < in.PreferredSuppliers(s); i++)
+        if (out.Open(in.PreferredSupplier(s,i)))
+          allowed[s].push_back(in.PreferredSupplier(s,i));
+      // current suppliers (if not preferred) keep the problem feasible
+      if (!in.Preference(s,out.FirstSupplier(s)))
+        allowed[s].push_back(out.FirstSupplier(s));
+      if (out.SecondSupplier(s) != -1 && !in.Preference(s,out.SecondSupplier(s)))
+        allowed[s].push_back(out.SecondSupplier(s));
+    }
+  while (rounds < max_rounds && SolveFlow())
+    {
+      rounds++;
+      candidate.Reset();
+      pending.clear();
+      for (s = 0; s < in.Stores(); s++)
+        {
+          flows.clear();
+          for (k = first_arc[s]; k < first_arc[s+1]; k++)
+            if (network.Flow(store_arcs[k].first) > 0)
+              flows.push_back(make_pair(network.Flow(store_arcs[k].first), store_arcs[k].second));
+          sort(flows.rbegin(), flows.rend());
+          for (k = 0; k < static_cast<int>(flows.size()); k++)
+            if (!candidate.Compatible(s,flows[k].second))
+              break;
+          if (k == static_cast<int>(flows.size()) && flows.size() <= 2)
+            {
+              candidate.AssignFirst(s,flows[0].second,flows[0].first);
+              if (flows.size() == 2)
+                candidate.AssignSecond(s,flows[1].second,flows[1].first);
+              else
+                candidate.AssignSecond(s,-1,0);
+            }
+          else
+            { 
+              if (k == static_cast<int>(flows.size()))
+                k = 2; // too many suppliers: only the two largest flows are kept
+              for (; k < static_cast<int>(flows.size()); k++)
+                if (k >= 2 || !candidate.Compatible(s,flows[k].second))
+                  allowed[s].erase(find(allowed[s].begin(), allowed[s].end(), flows[k].second));
+              pending.push_back(s);
+            }
+        }
+      if (pending.empty())
+        break;
+    }
+  // the stores left (if any) are placed greedily in the space left by the last flow
+  for (i = 0; i < static_cast<int>(pending.size()); i++)
+    if (!Place(candidate, out, pending[i]))
+      break;
+  if (rounds > 0 && i == static_cast<int>(pending.size()) && candidate.ComputeCost() < out.ComputeCost())
+    {
+      out = candidate;
+      improvements++;
+      improved = true;
+    }
+  time += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  return improved;
+}
+
+bool FLP_SupplyPolisher::SolveFlow()
+{ // nodes: 0 is the source, 1..stores the stores, then the warehouses and the sink; 
+  // true if all the goods can be supplied
+  int s, w, k, total_demand = 0, source = 0, sink = in.Stores() + in.Warehouses() + 1;
+
+  network.Clear(sink + 1);
+  store_arcs.clear();
+  for (s = 0; s < in.Stores(); s++)
+    {
+      network.AddArc(source, 1 + s, in.AmountOfGoods(s), 0);
+      total_demand += in.AmountOfGoods(s);
+      first_arc[s] = store_arcs.size();
+      for (k = 0; k < static_cast<int>(allowed[s].size()); k++)
+        {
+          w = allowed[s][k];
+          store_arcs.push_back(make_pair(network.AddArc(1 + s, 1 + in.Stores() + w, in.AmountOfGoods(s), in.SupplyCost(s,w)), w));
+        }
+    }
+  first_arc[in.Stores()] = store_arcs.size();
+  for (w = 0; w < in.Warehouses(); w++)
+    network.AddArc(1 + in.Stores() + w, sink, in.Capacity(w), 0);
+  return network.Solve(source, sink, total_demand) == total_demand;
+}
+
+bool FLP_SupplyPolisher::Place(FLP_Output& candidate, const FLP_Output& out, int s) const
+{ // the cheapest compatible warehouse (open in out) with enough space, or otherwise the cheapest
+  // pair: the first one gets as much as possible (but one unit), the second the rest
+  int i, j, w1, w2, q1, d = in.AmountOfGoods(s);
+  vector<int> suppliers;
+  for (w1 = 0; w1 < in.Warehouses(); w1++)
+    if (out.Open(w1) && candidate.Compatible(s,w1) && candidate.ResidualCapacity(w1) > 0)
+      suppliers.push_back(w1);
+  sort(suppliers.begin(), suppliers.end(), [this,s](int w1, int w2) { return in.SupplyCost(s,w1) < in.SupplyCost(s,w2); });
+  for (i = 0; i < static_cast<int>(suppliers.size()); i++)
+    if (candidate.ResidualCapacity(suppliers[i]) >= d)
+      {
+        candidate.FullAssign(s,suppliers[i]);
+        return true;
+      }
+  for (i = 0; i < static_cast<int>(suppliers.size()); i++)
+    {
+      w1 = suppliers[i];
+      q1 = min(candidate.ResidualCapacity(w1), d - 1);
+      for (j = 0; j < static_cast<int>(suppliers.size()); j++)
+        {
+          w2 = suppliers[j];
+          if (w2 != w1 && candidate.ResidualCapacity(w2) >= d - q1)
+            {
+              candidate.AssignFirst(s,w1,q1);
+              candidate.AssignSecond(s,w2,d - q1);
+              return true;
+            }
+        }
+    }
+  return false;
+}
+
+void FLP_MaxFlow::Clear(int nodes)
+{
+  arcs.clear();
+  out_arcs.assign(nodes, vector<int>());
+  level.resize(nodes);
+  current_arc.resize(nodes);
+}
+
+int FLP_MaxFlow::AddArc(int from, int to, int capacity)
+{
+  arcs.push_back(Arc{to, capacity});
+  out_arcs[from].push_back(arcs.size() - 1);
+  arcs.push_back(Arc{from, 0});
+  out_arcs[to].push_back(arcs.size() - 1);
+  return arcs.size() - 2;
+}
+
+long long FLP_MaxFlow::Solve(int source, int sink)
+{
+  long long flow = 0;
+  int pushed;
+  while (ComputeLevels(source, sink))
+    {
+      fill(current_arc.begin(), current_arc.end(), 0);
+      while ((pushed = Push(source, sink, numeric_limits<int>::max())) > 0)
+        flow += pushed;
+    }
+  return flow;
+}
+
+bool FLP_MaxFlow::ComputeLevels(int source, int sink)
+{ // breadth-first distances from the source on the arcs with residual capacity
+  int v;
+  queue<int> frontier;
+  fill(level.begin(), level.end(), -1);
+  level[source] = 0;
+  frontier.push(source);
+  while (!frontier.empty())
+    {
+      v = frontier.front();
+      frontier.pop();
+      for (int a : out_arcs[v])
+        if (arcs[a].capacity > 0 && level[arcs[a].to] == -1)
+          {
+            level[arcs[a].to] = level[v] + 1;
+            frontier.push(arcs[a].to);
+          }
+    }
+  return level[sink] != -1;
+}
+
+int FLP_MaxFlow::Push(int v, int sink, int limit)
+{ // depth-first search of a path that goes up one level at each arc (current_arc skips the exhausted ones)
+  int a, pushed;
+  if (v == sink)
+    return limit;
+  for (; current_arc[v] < static_cast<int>(out_arcs[v].size()); current_arc[v]++)
+    {
+      a = out_arcs[v][current_arc[v]];
+      if (arcs[a].capacity > 0 && level[arcs[a].to] == level[v] + 1)
+        {
+          pushed = Push(arcs[a].to, sink, min(limit, arcs[a].capacity));
+          if (pushed > 0)
+            {
+              arcs[a].capacity -= pushed;
+              arcs[a^1].capacity += pushed;
+              return pushed;
+            }
+        }
+    }
+  return 0;
+}
+
+bool FLP_FeasibilityOracle::Feasible()
+{ // nodes: the stores, then the warehouses, the source and the sink
+  int s, i, w;
+  int source = in.Stores() + in.Warehouses(), sink = source + 1;
+  network.Clear(sink + 1);
+  demand = 0;
+  for (s = 0; s < in.Stores(); s++)
+    {
+      network.AddArc(source, s, in.AmountOfGoods(s));
+      demand += in.AmountOfGoods(s);
+      for (i = 0; i < in.PreferredSuppliers(s); i++)
+        network.AddArc(s, in.Stores() + in.PreferredSupplier(s,i), in.AmountOfGoods(s));
+    }
+  for (w = 0; w < in.Warehouses(); w++)
+    network.AddArc(in.Stores() + w, sink, in.Capacity(w));
+  max_flow = network.Solve(source, sink);
+  return max_flow >= demand;
+}
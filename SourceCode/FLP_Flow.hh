@@ -0,0 +1,79 @@
+// File FLP_Flow.hh
+#ifndef FLP_FLOW_HH
+#define FLP_FLOW_HH
+#include "FLP_Output.hh"
+
+class FLP_MinCostFlow
+{ // successive shortest paths (Dijkstra with node potentials), for integer capacities and
+  // non-negative costs
+public:
+  void Clear(int nodes);
+  int AddArc(int from, int to, int capacity, CostType cost); // returns the index of the arc
+  int Solve(int source, int sink, int required); // returns the flow sent (at most required)
+  int Flow(int a) const { return arcs[a^1].capacity; } // arcs are stored in pairs: a^1 is the reverse of a
+private:
+  int Augment(int v, int sink, int limit);
+  struct Arc { int to, capacity; CostType cost; };
+  vector<Arc> arcs;
+  vector<vector<int>> out_arcs;
+  vector<long long> potential, distance;
+  vector<int> current_arc;
+  vector<bool> visited;
+};
+
+class FLP_MaxFlow
+{ // Dinic's algorithm (blocking flows on the level graph), for integer capacities
+public:
+  void Clear(int nodes);
+  int AddArc(int from, int to, int capacity); // returns the index of the arc
+  long long Solve(int source, int sink);
+  int Flow(int a) const { return arcs[a^1].capacity; } // arcs are stored in pairs: a^1 is the reverse of a
+private:
+  bool ComputeLevels(int source, int sink);
+  int Push(int v, int sink, int limit);
+  struct Arc { int to, capacity; };
+  vector<Arc> arcs;
+  vector<vector<int>> out_arcs;
+  vector<int> level, current_arc;
+};
+
+class FLP_FeasibilityOracle
+{ // maximum flow from the stores (their demands) to the warehouses (their capacities) along the preferred 
+  // pairs: if it does not cover the total demand no solution exists; otherwise the capacities are not in the
+  // way, although incompatibilities and the limit of two suppliers per store may still be
+public:
+  FLP_FeasibilityOracle(const FLP_Input& in) : in(in) {}
+  bool Feasible(); // false only if surely infeasible
+  long long MaxFlow() const { return max_flow; }
+  long long Demand() const { return demand; }
+private:
+  const FLP_Input& in;
+  FLP_MaxFlow network;
+  long long max_flow = 0, demand = 0;
+};
+
+class FLP_SupplyPolisher
+{ // optimal quantities for the set of open warehouses of a solution: the transportation problem from
+  // the stores to the open warehouses (preferred or current suppliers of each store) is solved by min-cost
+  // flow, and solved again without the arcs that give more than two suppliers or incompatible partners
+  // to a store (the stores still in conflict after a few rounds are placed greedily); the result 
+  // replaces the solution only if it is better
+public:
+  FLP_SupplyPolisher(const FLP_Input& in, int max_rounds = 32);
+  bool Polish(FLP_Output& out); // true if out has been improved
+  unsigned Calls() const { return calls; }
+  unsigned Improvements() const { return improvements; }
+  double Time() const { return time; } // total time spent (in seconds)
+private:
+  bool SolveFlow(); // on the allowed arcs
+  bool Place(FLP_Output& candidate, const FLP_Output& out, int s) const;
+  const FLP_Input& in;
+  int max_rounds;
+  FLP_MinCostFlow network;
+  vector<vector<int>> allowed; // open warehouses that can supply each store
+  vector<int> first_arc; // index of the first arc of each store in store_arcs
+  vector<pair<int,int>> store_arcs; // (arc, warehouse) for the arcs from each store
+  unsigned calls, improvements;
+  double time;
+};
+#endif
@@ -0,0 +1,75 @@
+// File FLP_Generate.cc
+// the synthetic instance generator (see FLP_Generator.hh): the features are given as --<name> <value>, and
+// the instance is written on the output file (or on stdout); the actual number of incompatibilities and the
+// actual demand ratio are printed on stderr
+#include <fstream>
+#include <map>
+#include <functional>
+#include <stdexcept>
+#include "FLP_Generator.hh"
+
+int main(int argc, const char* argv[])
+{
+  FLP_GeneratorParameters p;
+  string output = "-";
+  int i;
+  map<string, function<void(const string&)>> options =
+    {
+      {"customers", [&p](const string& v) { p.customers = stoi(v); }},
+      {"facilities", [&p](const string& v) { p.facilities = stoi(v); }},
+      {"incompatibility_density", [&p](const string& v) { p.incompatibility_density = stod(v); }},
+      {"incompatibilities", [&p](const string& v) { p.incompatibilities = stoll(v); }},
+      {"opening_cost", [&p](const string& v) { p.opening_cost = stod(v); }},
+      {"supply_cost", [&p](const string& v) { p.supply_cost = stod(v); }},
+      {"demand_ratio", [&p](const string& v) { p.demand_ratio = stod(v); }},
+      {"min_demand", [&p](const string& v) { p.min_demand = stoi(v); }},
+      {"max_demand", [&p](const string& v) { p.max_demand = stoi(v); }},
+      {"seed", [&p](const string& v) { p.seed = stoul(v); }},
+      {"output", [&output](const string& v) { output = v; }}
+    };
+  for (i = 1; i + 1 < argc && argv[i][0] == '-' && argv[i][1] == '-' && options.count(argv[i] + 2); i += 2)
+    try
+      {
+        options[argv[i] + 2](argv[i+1]);
+      }
+    catch (const logic_error&)
+      {
+        cerr << "Invalid value " << argv[i+1] << " of " << argv[i] << endl;
+        return 1;
+      }
+  if (i < argc)
+    {
+      cerr << "Usage: " << argv[0] << " [--<option> <value>]..., with the options" << endl;
+      for (const auto& option : options)
+        cerr << "  --" << option.first << endl;
+      return 1;
+    }
+  try
+    {
+      FLP_Generator generator(p);
+      if (output == "-")
+        generator.Write(cout);
+      else
+        {
+          ofstream os(output.c_str());
+          if (!os)
+            {
+              cerr << "Cannot open the output file " << output << endl;
+              return 1;
+            }
+          generator.Write(os);
+          if (!os)
+            {
+              cerr << "Cannot write the output file " << output << endl;
+              return 1;
+            }
+        }
+      cerr << "Incompatibilities: " << generator.Incompatibilities() << ", demand ratio: " << generator.DemandRatio() << endl;
+    }
+  catch (const invalid_argument& e)
+    {
+      cerr << e.what() << endl;
+      return 1;
+    }
+  return 0;
+}
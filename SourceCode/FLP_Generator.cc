@@ -0,0 +1,227 @@
+// File FLP_Generator.cc
+#include <cmath>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include "FLP_Generator.hh"
+
+namespace
+{
+  // the points have integer coordinates in [0,GRID), so that their squared distances are exact
+  const int64_t GRID = 1 << 24;
+  // mean distance of two uniform points of the unit square, (2 + sqrt(2) + 5 ln(1 + sqrt(2))) / 15, written
+  // out because log is not correctly rounded: the average supply cost is supply_cost
+  const double MEAN_DISTANCE = 0.52140543316472067833;
+  const size_t BUFFER_SIZE = 1 << 16;
+  const uint64_t ONE = 1ULL << 63; // 1 in the fixed point (63 fractional bits) of the geometric gaps
+
+  // the distributions of <random> are implementation-defined, and the functions of <cmath> but sqrt are not
+  // correctly rounded: these ones use integers and single IEEE operations only (no expression a * b + c,
+  // which a compiler may contract), so they give the same numbers everywhere
+  double Uniform(Xoshiro256StarStar& g) // in [0,1)
+  { return (g() >> 11) * 0x1.0p-53; }
+
+  int Uniform(Xoshiro256StarStar& g, int a, int b) // in [a,b]
+  { return a + static_cast<int>(Uniform(g) * (b - a + 1)); }
+
+  int64_t Coordinate(Xoshiro256StarStar& g) // in [0,GRID)
+  { return g() >> 40; }
+
+  uint64_t Multiply(uint64_t a, uint64_t b) // fixed point, a and b at most ONE
+  { return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 63); }
+
+  Xoshiro256StarStar Stream(unsigned seed, unsigned k)
+  { // each feature is drawn from its own stream, so that changing one of them does not change the others
+    return Xoshiro256StarStar((static_cast<uint64_t>(seed) << 3) | k);
+  }
+
+  class Writer
+  { // the numbers are formatted with to_chars in a buffer, flushed to the stream when full
+  public:
+    Writer(ostream& s) : os(s), length(0) {}
+    ~Writer() { Flush(); }
+    Writer& operator<<(long long x)
+    {
+      Reserve(24);
+      length = to_chars(buffer + length, buffer + BUFFER_SIZE, x).ptr - buffer;
+      return *this;
+    }
+    Writer& operator<<(const char* s)
+    {
+      size_t n = strlen(s);
+      Reserve(n);
+      memcpy(buffer + length, s, n);
+      length += n;
+      return *this;
+    }
+    void Flush()
+    {
+      os.write(buffer, length);
+      length = 0;
+    }
+  private:
+    void Reserve(size_t n)
+    {
+      if (length + n > BUFFER_SIZE)
+        Flush();
+    }
+    ostream& os;
+    char buffer[BUFFER_SIZE];
+    size_t length;
+  };
+}
+
+FLP_Generator::FLP_Generator(const FLP_GeneratorParameters& parameters)
+  : p(parameters)
+{
+  int s, w, j;
+  long long base_capacity = 0;
+  double pairs, scale, mean_capacity;
+  if (p.customers < 1 || p.facilities < 1)
+    throw invalid_argument("The numbers of customers and of facilities must be positive");
+  if (p.incompatibility_density < 0.0 || p.incompatibility_density > 1.0)
+    throw invalid_argument("The incompatibility density must be between 0 and 1");
+  if (p.demand_ratio <= 0.0 || p.demand_ratio > 1.0)
+    throw invalid_argument("The demand ratio must be in (0,1]");
+  if (p.min_demand < 2 || p.max_demand < p.min_demand)
+    throw invalid_argument("The demands must be at least 2 (they are split among two suppliers), and min_demand <= max_demand");
+  if (p.opening_cost < 0.0 || p.supply_cost < 0.0)
+    throw invalid_argument("The costs must be non-negative");
+  pairs = 0.5 * p.customers * (p.customers - 1.0);
+  if (p.incompatibilities >= 0)
+    pair_probability = pairs > 0.0 ? min(1.0, p.incompatibilities / pairs) : 0.0;
+  else
+    pair_probability = p.incompatibility_density;
+
+  Xoshiro256StarStar points = Stream(p.seed, 0), demands = Stream(p.seed, 1), capacities = Stream(p.seed, 2),
+    costs = Stream(p.seed, 3);
+  customer_x.resize(p.customers);
+  customer_y.resize(p.customers);
+  facility_x.resize(p.facilities);
+  facility_y.resize(p.facilities);
+  for (w = 0; w < p.facilities; w++)
+    {
+      facility_x[w] = Coordinate(points);
+      facility_y[w] = Coordinate(points);
+    }
+  for (s = 0; s < p.customers; s++)
+    {
+      customer_x[s] = Coordinate(points);
+      customer_y[s] = Coordinate(points);
+    }
+
+  demand.resize(p.customers);
+  total_demand = 0;
+  for (s = 0; s < p.customers; s++)
+    {
+      demand[s] = Uniform(demands, p.min_demand, p.max_demand);
+      total_demand += demand[s];
+    }
+
+  // the capacities are drawn as in CFLP-CI, and scaled so that total demand / total capacity = demand_ratio
+  capacity.resize(p.facilities);
+  for (w = 0; w < p.facilities; w++)
+    {
+      capacity[w] = 10 * Uniform(capacities, 3, 10);
+      base_capacity += capacity[w];
+    }
+  scale = total_demand / (p.demand_ratio * base_capacity);
+  total_capacity = 0;
+  for (w = 0; w < p.facilities; w++)
+    {
+      capacity[w] = max(1L, lround(capacity[w] * scale));
+      total_capacity += capacity[w];
+    }
+
+  // +/- 30%, in thousandths
+  mean_capacity = double(total_capacity) / p.facilities;
+  fixed_cost.resize(p.facilities);
+  for (w = 0; w < p.facilities; w++)
+    fixed_cost[w] = lround(p.opening_cost * capacity[w] / mean_capacity * Uniform(costs, 700, 1300) / 1000.0);
+
+  // powers (1 - p)^(2^j) of the probability that a pair is compatible, for the geometric gaps
+  complement_powers.assign(32, 0);
+  complement_powers[0] = ONE - static_cast<uint64_t>(min(pair_probability, 1.0) * 0x1.0p63);
+  for (j = 1; j < 32; j++)
+    complement_powers[j] = Multiply(complement_powers[j-1], complement_powers[j-1]);
+
+  incompatibilities = 0;
+  ForEachIncompatibility([this](int, int) { incompatibilities++; });
+}
+
+template <typename Visit>
+void FLP_Generator::ForEachIncompatibility(Visit visit) const
+{ // the pairs (s1,s2), s1 < s2, in lexicographic order; the gaps between incompatible pairs are geometric, so
+  // the time is proportional to their number, and the same stream gives the same pairs at each call
+  int s1, s2;
+  long long gap;
+  Xoshiro256StarStar pairs = Stream(p.seed, 4);
+  if (pair_probability <= 0.0)
+    return;
+  for (s1 = 0; s1 < p.customers; s1++)
+    {
+      s2 = s1 + 1;
+      while (true)
+        {
+          if (pair_probability < 1.0)
+            {
+              gap = GeometricGap(pairs);
+              if (gap >= p.customers - s2)
+                break;
+              s2 += static_cast<int>(gap);
+            }
+          if (s2 >= p.customers)
+            break;
+          visit(s1, s2);
+          s2++;
+        }
+    }
+}
+
+long long FLP_Generator::GeometricGap(Xoshiro256StarStar& g) const
+{ // the largest k such that (1 - p)^k >= u, for u uniform in (0,1] (that is, floor(ln u / ln(1 - p))), by
+  // its binary digits from the powers (1 - p)^(2^j), in fixed point
+  int j;
+  long long k = 0;
+  uint64_t u = (g() >> 1) + 1, power = ONE, next;
+  for (j = complement_powers.size() - 1; j >= 0; j--)
+    {
+      next = Multiply(power, complement_powers[j]);
+      if (next >= u)
+        {
+          power = next;
+          k += 1LL << j;
+        }
+    }
+  return k;
+}
+
+void FLP_Generator::Write(ostream& os) const
+{ // the format of the CFLP-CI instances, with 1-based ids of the customers in the incompatible pairs
+  int s, w;
+  int64_t dx, dy;
+  Writer out(os);
+  out << "Facilities = " << p.facilities << ";\nCustomers = " << p.customers << ";\n\nCapacity = [";
+  for (w = 0; w < p.facilities; w++)
+    out << (w > 0 ? ", " : "") << capacity[w];
+  out << "];\nFixedCost = [";
+  for (w = 0; w < p.facilities; w++)
+    out << (w > 0 ? ", " : "") << fixed_cost[w];
+  out << "];\nDemand = [";
+  for (s = 0; s < p.customers; s++)
+    out << (s > 0 ? ", " : "") << demand[s];
+  out << "];\nShippingCost = [";
+  for (s = 0; s < p.customers; s++)
+    {
+      out << (s > 0 ? "\n              |" : "|");
+      for (w = 0; w < p.facilities; w++)
+        {
+          dx = customer_x[s] - facility_x[w];
+          dy = customer_y[s] - facility_y[w];
+          out << (w > 0 ? ", " : "") << lround(p.supply_cost * sqrt(static_cast<double>(dx * dx + dy * dy)) / (MEAN_DISTANCE * GRID));
+        }
+    }
+  out << "|];\n\nIncompatibilities = " << incompatibilities << ";\nIncompatiblePairs = [|";
+  ForEachIncompatibility([&out](int s1, int s2) { out << " " << s1 + 1 << ", " << s2 + 1 << " |"; });
+  out << "];\n";
+}
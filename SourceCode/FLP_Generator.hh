@@ -0,0 +1,47 @@
+// File FLP_Generator.hh
+#ifndef FLP_GENERATOR_HH
+#define FLP_GENERATOR_HH
+#include <iostream>
+#include <string>
+#include <vector>
+#include "FLP_Random.hh"
+
+using namespace std;
+
+struct FLP_GeneratorParameters
+{ // the features of Instances/CFLP-CI/cflp-ci_features.csv; the defaults are close to the averages of the
+  // CFLP-CI instances (only the sizes are smaller)
+  int customers = 1000, facilities = 400;
+  double incompatibility_density = 0.06; // fraction of the pairs of customers that are incompatible
+  long long incompatibilities = -1; // expected number of incompatible pairs, it overrides the density if >= 0
+  double opening_cost = 750.0, supply_cost = 52.5; // averages
+  double demand_ratio = 0.5; // total demand / total capacity
+  int min_demand = 5, max_demand = 20;
+  unsigned seed = 0;
+};
+
+class FLP_Generator
+{ // random instances in the .dzn format read by FLP_Input: facilities and customers are uniform points of the
+  // unit square, the supply costs are proportional to their distances, the capacities (30, 40, ..., 100 as in
+  // CFLP-CI) are scaled to meet the demand ratio, the fixed costs are proportional to the capacities (+/- 30%),
+  // and each pair of customers is incompatible with the same probability; the same parameters (and seed)
+  // always give the same instance, on any platform with IEEE doubles (the sampling uses integers, and
+  // floating point only for single correctly rounded operations)
+public:
+  FLP_Generator(const FLP_GeneratorParameters& parameters); // throws invalid_argument on inconsistent parameters
+  // the instance is streamed: the memory is O(S + W), also for instances too large to be loaded densely
+  void Write(ostream& os) const;
+  long long Incompatibilities() const { return incompatibilities; } // the actual number
+  double DemandRatio() const { return double(total_demand) / total_capacity; } // the actual ratio
+private:
+  template <typename Visit>
+  void ForEachIncompatibility(Visit visit) const;
+  long long GeometricGap(Xoshiro256StarStar& g) const; // compatible pairs before the next incompatible one
+  FLP_GeneratorParameters p;
+  double pair_probability;
+  vector<uint64_t> complement_powers; // (1 - pair_probability)^(2^j), 63 fractional bits
+  vector<int64_t> customer_x, customer_y, facility_x, facility_y; // in [0,2^24)
+  vector<int> capacity, fixed_cost, demand;
+  long long total_demand, total_capacity, incompatibilities;
+};
+#endif
@@ -1,8 +1,10 @@
 // File FLP_Helpers.cc
 #include "FLP_Helpers.hh"
+#include "FLP_Flow.hh"
 
-FLP_SolutionManager::FLP_SolutionManager(const FLP_Input & pin) 
-  : SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>>(pin, "FLPSolutionManager")  {} 
+FLP_SolutionManager::FLP_SolutionManager(const FLP_Input & pin, bool check_capacity) 
+  : SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>>(pin, "FLPSolutionManager"),
+    stuck_store(-1), in_chain(pin.Warehouses(),false), capacity_checked(!check_capacity), greedy_repairs(0), greedy_restarts(0) {} 
 
 void FLP_SolutionManager::DumpState(const FLP_Output& out, ostream& os) const
 {
@@ -16,15 +18,16 @@ void FLP_SolutionManager::RandomState(FLP_Output& out)
   out.Reset();
   for (s = 0; s < in.Stores(); s++)
     {
-      single_source = static_cast<bool>(Random::Uniform<int>(1,100) <= 80); // 80% single source
+      CheckStop(in.Stores() - s);
+      single_source = static_cast<bool>(FLP_Random::Uniform(1,100) <= 80); // 80% single source
       do 
         {
-          i = Random::Uniform<int>(0, in.PreferredSuppliers(s) - 1);
+          i = FLP_Random::Uniform(0, in.PreferredSuppliers(s) - 1);
           w1 = in.PreferredSupplier(s,i);
           if (single_source)
             q1 = in.AmountOfGoods(s);
           else
-            q1 = Random::Uniform<int>(1,in.AmountOfGoods(s)-1);
+            q1 = FLP_Random::Uniform(1,in.AmountOfGoods(s)-1);
         } 
       while (!out.Compatible(s,w1) || out.Load(w1) + q1 > in.Capacity(w1));
       out.AssignFirst(s,w1,q1);
@@ -32,7 +35,7 @@ void FLP_SolutionManager::RandomState(FLP_Output& out)
         {
           do 
             {
-              i = Random::Uniform<int>(0, in.PreferredSuppliers(s) - 1);
+              i = FLP_Random::Uniform(0, in.PreferredSuppliers(s) - 1);
               w2 = in.PreferredSupplier(s,i);
               q2 = in.AmountOfGoods(s) - q1;
             } 
@@ -52,17 +55,22 @@ void FLP_SolutionManager::GreedyState(FLP_Output& out)
   const double equal_tolerance = 0.288;
   const double amortization_factor = 0.25;
   
-  vector<int> unserved_stores;
+  vector<int> unserved_stores, stuck_stores;
+
+  CheckCapacity();
 
   int count = 0;
-  do // repeat the full procedure until an initial feasible solution is found
+  do // repeat the full procedure until an initial feasible solution is found (the repair rarely fails)
   {
+    if (count > 0)
+      greedy_restarts++;
     out.Reset();
     unserved_stores.resize(in.Stores());
     iota(unserved_stores.begin(), unserved_stores.end(),0);
     count++;
     while(unserved_stores.size() > 0)
       {
+        CheckStop(unserved_stores.size());
         found_first = false;
         for (i = 0; i < static_cast<int>(unserved_stores.size()); i++)
           {
@@ -84,12 +92,12 @@ void FLP_SolutionManager::GreedyState(FLP_Output& out)
                         best_w = w;
                         best_s = s;
                         best_i = i;
-                        best_cost = in.SupplyCost(s,w) + amortized_fixed_cost;
+                        best_cost = in.PreferredSupplierCost(s,j) + amortized_fixed_cost;
                         equal_bests = 1;
                       }
                     else
                       {
-                        cost = in.SupplyCost(s,w) + amortized_fixed_cost;
+                        cost = in.PreferredSupplierCost(s,j) + amortized_fixed_cost;
                         if (cost < best_cost) // if better, becomes new best (without tolerance)
                           {
                             best_w = w;
@@ -101,7 +109,7 @@ void FLP_SolutionManager::GreedyState(FLP_Output& out)
                         else if (cost < best_cost + equal_tolerance)
                           {
                             equal_bests++;
-                            if (Random::Uniform<int>(1,equal_bests) == 1)
+                            if (FLP_Random::Uniform(1,equal_bests) == 1)
                               {
                                 best_w = w;
                                 best_s = s;
@@ -114,7 +122,14 @@ void FLP_SolutionManager::GreedyState(FLP_Output& out)
               }
           }
         if (!found_first)
-          break;
+          { // all the unserved stores are stuck
+            stuck_stores = unserved_stores;
+            unserved_stores.clear();
+            for (int s : stuck_stores)
+              if (!RepairStore(out,s))
+                unserved_stores.push_back(s);
+            break;
+          }
         if (out.FirstSupplier(best_s) == -1)
           { 
             if (out.ResidualCapacity(best_w) >= in.AmountOfGoods(best_s))
@@ -133,15 +148,202 @@ void FLP_SolutionManager::GreedyState(FLP_Output& out)
             unserved_stores.erase(unserved_stores.begin() + best_i);
           }
       }
-    if (count == 50)
-      {
-        cout << "{\"cost\": " << 100000000000 <<  ", \"greedy\": \"infeasible\"}" << endl;
-        exit(0);
-      }
+    if (unserved_stores.size() > 0 && count == 50)
+      throw FLP_ConstructionError("stuck", "\"unserved_stores\": " + to_string(unserved_stores.size()));
   }
   while (unserved_stores.size() > 0);
 }
 
+void FLP_SolutionManager::CheckStop(int unserved_stores) const
+{
+  if (stop && stop())
+    throw FLP_ConstructionError("interrupted", "\"unserved_stores\": " + to_string(unserved_stores));
+}
+
+void FLP_SolutionManager::CheckCapacity()
+{ // no construction can succeed if the capacities cannot cover the demands
+  if (capacity_checked)
+    return;
+  FLP_FeasibilityOracle oracle(in);
+  if (!oracle.Feasible())
+    throw FLP_ConstructionError("infeasible", "\"max_flow\": " + to_string(oracle.MaxFlow()) 
+                                + ", \"demand\": " + to_string(oracle.Demand()));
+  capacity_checked = true;
+}
+
+bool FLP_SolutionManager::RepairStore(FLP_Output& out, int s)
+{ // the rest of s goes to a single preferred warehouse, in order of supply cost
+  int i, w, rest = in.AmountOfGoods(s) - (out.FirstSupplier(s) == -1 ? 0 : out.FirstQuantity(s));
+  bool done;
+  vector<int> clients;
+  stuck_store = s;
+  for (i = 0; i < in.PreferredSuppliers(s); i++)
+    {
+      w = in.PreferredSupplier(s,i);
+      if (w == out.FirstSupplier(s))
+        continue;
+      out.StartJournal();
+      in_chain[w] = true;
+      done = true;
+      clients.assign(out.Clients(w), 0);
+      for (unsigned k = 0; k < clients.size(); k++)
+        clients[k] = out.Client(w,k);
+      for (int c : clients)
+        if (in.Incompatible(s,c) && (out.FirstSupplier(c) == w || out.SecondSupplier(c) == w) 
+            && !Relocate(out,c,w,MAX_CHAIN_DEPTH))
+          {
+            done = false;
+            break;
+          }
+      if (done && out.ResidualCapacity(w) < rest)
+        done = Free(out,w,rest - out.ResidualCapacity(w),MAX_CHAIN_DEPTH);
+      in_chain[w] = false;
+      if (done && out.Compatible(s,w) && out.ResidualCapacity(w) >= rest)
+        {
+          if (out.FirstSupplier(s) == -1)
+            out.FullAssign(s,w);
+          else
+            out.AssignSecond(s,w,rest);
+          out.Commit();
+          greedy_repairs++;
+          return true;
+        }
+      out.Rollback();
+    }
+  out.Commit(); // closes the journal
+  return false;
+}
+
+bool FLP_SolutionManager::Relocate(FLP_Output& out, int c, int w, int depth)
+{ // to a warehouse with room, otherwise to one freed by a shorter chain
+  int i, v, q = out.FirstSupplier(c) == w ? out.FirstQuantity(c) : out.SecondQuantity(c);
+  Position pos = out.FirstSupplier(c) == w ? Position::FIRST : Position::SECOND;
+  bool done;
+  for (i = 0; i < in.PreferredSuppliers(c); i++)
+    {
+      v = in.PreferredSupplier(c,i);
+      if (v != w && !in_chain[v] && out.Compatible(c,v) && out.ResidualCapacity(v) >= q)
+        {
+          out.ReplaceSupplier(c,pos,v,q);
+          return true;
+        }
+    }
+  if (depth == 0)
+    return false;
+  for (i = 0; i < in.PreferredSuppliers(c); i++)
+    {
+      v = in.PreferredSupplier(c,i);
+      if (v == w || in_chain[v] || !out.Compatible(c,v))
+        continue;
+      in_chain[v] = true;
+      done = Free(out,v,q - out.ResidualCapacity(v),depth - 1);
+      in_chain[v] = false;
+      if (out.FirstSupplier(c) != w && out.SecondSupplier(c) != w)
+        return true; // c has been moved out of w by the chain itself
+      pos = out.FirstSupplier(c) == w ? Position::FIRST : Position::SECOND; // its suppliers may have been reordered
+      q = pos == Position::FIRST ? out.FirstQuantity(c) : out.SecondQuantity(c);
+      if (done && out.Compatible(c,v) && out.ResidualCapacity(v) >= q)
+        {
+          out.ReplaceSupplier(c,pos,v,q);
+          return true;
+        }
+    }
+  return false;
+}
+
+bool FLP_SolutionManager::Free(FLP_Output& out, int w, int amount, int depth)
+{
+  int c, room = out.ResidualCapacity(w) + amount;
+  vector<int> clients(out.Clients(w));
+  for (unsigned k = 0; k < clients.size(); k++)
+    clients[k] = out.Client(w,k);
+  for (unsigned k = 0; k < clients.size() && out.ResidualCapacity(w) < room; k++)
+    {
+      c = clients[k];
+      if (c != stuck_store && (out.FirstSupplier(c) == w || out.SecondSupplier(c) == w)) // not moved meanwhile
+        Relocate(out,c,w,depth);
+    }
+  return out.ResidualCapacity(w) >= room;
+}
+
+int FLP_SolutionManager::RepairState(FLP_Output& out, bool rebuild)
+{ 
+  int s, w, i;
+  bool valid;
+  vector<int> removed;
+  vector<pair<CostType,int>> clients;
+  if (rebuild)
+    out.Rebuild();
+  for (s = 0; s < in.Stores(); s++)
+    { // the stores are checked after the removal of the previous ones (one store of an incompatible pair is enough)
+      valid = out.FirstSupplier(s) != -1 && out.FirstQuantity(s) > 0
+        && (out.SecondSupplier(s) == -1 || (out.SecondSupplier(s) != out.FirstSupplier(s) && out.SecondQuantity(s) > 0))
+        && out.FirstQuantity(s) + out.SecondQuantity(s) == in.AmountOfGoods(s);
+      for (int v : {out.FirstSupplier(s), out.SecondSupplier(s)})
+        if (v != -1 && (!in.Preference(s,v) || !out.Compatible(s,v)))
+          valid = false;
+      if (!valid)
+        {
+          out.Unassign(s);
+          removed.push_back(s);
+        }
+    }
+  for (w = 0; w < in.Warehouses(); w++)
+    if (out.ResidualCapacity(w) < 0)
+      { // the most expensive clients leave first
+        clients.clear();
+        for (i = 0; i < out.Clients(w); i++)
+          clients.push_back(make_pair(in.SupplyCost(out.Client(w,i),w), out.Client(w,i)));
+        sort(clients.begin(), clients.end(), greater<pair<CostType,int>>());
+        for (i = 0; out.ResidualCapacity(w) < 0; i++)
+          {
+            out.Unassign(clients[i].second);
+            removed.push_back(clients[i].second);
+          }
+      }
+  for (int s : removed)
+    if (!Place(out,s))
+      return -1;
+  return removed.size();
+}
+
+bool FLP_SolutionManager::Place(FLP_Output& out, int s)
+{ // a single supplier if possible (the opening cost is charged to the whole store), otherwise the first 
+  // one with the largest room, and the rest by RepairStore
+  int i, w, best_w = -1, q = in.AmountOfGoods(s);
+  CostType cost, best_cost = 0;
+  for (i = 0; i < in.PreferredSuppliers(s); i++)
+    {
+      w = in.PreferredSupplier(s,i);
+      if (!out.Compatible(s,w) || out.ResidualCapacity(w) < q)
+        continue;
+      cost = in.PreferredSupplierCost(s,i) * q + (out.Closed(w) ? in.FixedCost(w) : 0);
+      if (best_w == -1 || cost < best_cost)
+        {
+          best_w = w;
+          best_cost = cost;
+        }
+    }
+  if (best_w != -1)
+    {
+      out.FullAssign(s,best_w);
+      return true;
+    }
+  for (i = 0; i < in.PreferredSuppliers(s); i++)
+    {
+      w = in.PreferredSupplier(s,i);
+      if (out.Compatible(s,w) && out.ResidualCapacity(w) > 0 && (best_w == -1 || out.ResidualCapacity(w) > out.ResidualCapacity(best_w)))
+        best_w = w;
+    }
+  if (best_w != -1)
+    out.AssignFirst(s,best_w,out.ResidualCapacity(best_w));
+  if (RepairStore(out,s))
+    return true;
+  if (best_w != -1)
+    out.Unassign(s);
+  return RepairStore(out,s);
+}
+
 bool FLP_SolutionManager::CheckConsistency(const FLP_Output& st) const
 {
   int w, load, i, s;
@@ -272,6 +474,107 @@ void FLP_Opening::PrintViolations(const FLP_Output& st, ostream& os) const
       os << "The cost of opening warehouse " << w << " is " << in.FixedCost(w) << endl;
 }
 
+void FLP_Total::PrintViolations(const FLP_Output& st, ostream& os) const
+{
+  supply.PrintViolations(st, os);
+  opening.PrintViolations(st, os);
+}
+
+int FenwickTree::Find(int& r) const
+{ // descends from the highest power of two, skipping the prefixes that do not exceed r
+  int i = 0, step;
+  for (step = top; step > 0; step /= 2)
+    if (i + step < static_cast<int>(tree.size()) && tree[i + step] <= r)
+      {
+        i += step;
+        r -= tree[i];
+      }
+  return i;
+}
+
+SupplierMasks::SupplierMasks(const FLP_Input& my_in)
+  : in(my_in), first_word(in.Stores()), words(in.Stores()), count(in.Stores(),0), dirty(in.Stores(),false), 
+    weights(in.Stores())
+{ 
+  int s;
+  unsigned total_words = 0;
+  for (s = 0; s < in.Stores(); s++)
+    {
+      words[s] = (in.PreferredSuppliers(s) + 63)/64;
+      first_word[s] = total_words;
+      total_words += 2*words[s];
+      MarkDirty(s);
+    }
+  bits.resize(total_words,0);
+  seen_identity = 0; // identities start from 1
+  seen_version = 0;
+}
+
+void SupplierMasks::Synchronize(const FLP_Output& st)
+{ // the feasibility of a Change of s depends only on the loads (and the clients) of its suppliers and of its 
+  // preferred suppliers, and s is either a client or a preferred client of each of them
+  int s, w, i;
+  if (st.Identity() != seen_identity)
+    for (s = 0; s < in.Stores(); s++)
+      MarkDirty(s);
+  else if (st.Version() != seen_version)
+    for (w = 0; w < in.Warehouses(); w++)
+      if (st.LastModified(w) > seen_version)
+        {
+          for (i = 0; i < in.PreferredClients(w); i++)
+            MarkDirty(in.PreferredClient(w,i));
+          for (i = 0; i < st.Clients(w); i++)
+            MarkDirty(st.Client(w,i));
+        }
+  seen_identity = st.Identity();
+  seen_version = st.Version();
+}
+
+void SupplierMasks::MarkDirty(int s)
+{
+  if (dirty[s])
+    return;
+  dirty[s] = true;
+  weights.Add(s, 2*in.PreferredSuppliers(s) - count[s]);
+  count[s] = 2*in.PreferredSuppliers(s);
+}
+
+void SupplierMasks::Clear(int s)
+{
+  fill(bits.begin() + first_word[s], bits.begin() + first_word[s] + 2*words[s], 0ULL);
+}
+
+void SupplierMasks::SetClean(int s)
+{
+  int j, c = 0;
+  for (j = 0; j < 2*words[s]; j++)
+    c += __builtin_popcountll(bits[first_word[s] + j]);
+  weights.Add(s, c - count[s]);
+  count[s] = c;
+  dirty[s] = false;
+}
+
+void SupplierMasks::Select(int s, int r, Position& pos, int& i) const
+{
+  int j, b;
+  unsigned long long word;
+  for (j = 0; j < 2*words[s]; j++)
+    {
+      word = bits[first_word[s] + j];
+      if (r >= __builtin_popcountll(word))
+        {
+          r -= __builtin_popcountll(word);
+          continue;
+        }
+      for (b = 0; b < r; b++)
+        word &= word - 1; // the lowest r bits are removed
+      pos = (j < words[s] ? Position::FIRST : Position::SECOND);
+      i = 64*(j % words[s]) + __builtin_ctzll(word);
+      return;
+    }
+  throw logic_error("Move out of the masks of store " + to_string(s));
+}
+
 /*****************************************************************************
  * FLP_Change Neighborhood Explorer Methods
  *****************************************************************************/
@@ -312,21 +615,77 @@ ostream& operator<<(ostream& os, const FLP_Change& mv)
 
 void FLP_ChangeNeighborhoodExplorer::RandomMove(const FLP_Output& st, FLP_Change& mv) const
 {
+  if (filtered_sampling)
+    {
+      FilteredRandomMove(st,mv);
+      return;
+    }
   do 
     {
-      mv.store = Random::Uniform<int>(0, in.Stores()-1);
+      counter.Draw();
+      mv.store = FLP_Random::Uniform(0, in.Stores()-1);
       mv.old_w1 = st.FirstSupplier(mv.store);
       mv.old_w2 = st.SecondSupplier(mv.store);
       if (mv.old_w2 == -1)
-        mv.pos = static_cast<Position>(Random::Uniform<int>(0, 1));
+        mv.pos = static_cast<Position>(FLP_Random::Uniform(0, 1));
       else
         mv.pos = Position::SECOND; // case mv.pos == Position::FIRST && mv.old_w2 != -1 eliminated (Andrea 4/5/2023)
-      mv.new_w_index = Random::Uniform<int>(0, in.PreferredSuppliers(mv.store)-1);
+      mv.new_w_index = FLP_Random::Uniform(0, in.PreferredSuppliers(mv.store)-1);
       mv.new_w = in.PreferredSupplier(mv.store,mv.new_w_index);
     }
   while (!FeasibleMove(st,mv));
+  counter.Sample();
 } 
 
+void FLP_ChangeNeighborhoodExplorer::FilteredRandomMove(const FLP_Output& st, FLP_Change& mv) const
+{ // a unit of the total weight of the stores is drawn uniformly; if it falls in a dirty store, the masks of 
+  // the store are recomputed and the draw is kept only if it is within its exact count: at each draw every
+  // feasible move has the same probability, and the draws are wasted only on the excess weight of dirty stores
+  int r;
+  masks.Synchronize(st);
+  while (true)
+    {
+      if (masks.Total() == 0)
+        throw runtime_error("No feasible Change move");
+      counter.Draw();
+      r = FLP_Random::Uniform(0, masks.Total()-1);
+      mv.store = masks.Find(r);
+      if (masks.Dirty(mv.store))
+        RefreshMasks(st,mv.store);
+      if (r < masks.Count(mv.store))
+        break;
+    }
+  counter.Sample();
+  masks.Select(mv.store,r,mv.pos,mv.new_w_index);
+  mv.old_w1 = st.FirstSupplier(mv.store);
+  mv.old_w2 = st.SecondSupplier(mv.store);
+  mv.new_w = in.PreferredSupplier(mv.store,mv.new_w_index);
+  FeasibleMove(st,mv); // surely true, it computes mv.new_q
+}
+
+void FLP_ChangeNeighborhoodExplorer::RefreshMasks(const FLP_Output& st, int s) const
+{
+  FLP_Change mv;
+  int i;
+  mv.store = s;
+  mv.old_w1 = st.FirstSupplier(s);
+  mv.old_w2 = st.SecondSupplier(s);
+  masks.Clear(s);
+  for (Position pos : {Position::FIRST, Position::SECOND})
+    {
+      mv.pos = pos;
+      if (pos == Position::FIRST && mv.old_w2 != -1)
+        continue; // never feasible (see FeasibleMove)
+      for (i = 0; i < in.PreferredSuppliers(s); i++)
+        {
+          mv.new_w = in.PreferredSupplier(s,i);
+          if (FeasibleMove(st,mv))
+            masks.Set(s,mv.pos,i);
+        }
+    }
+  masks.SetClean(s);
+}
+
 bool FLP_ChangeNeighborhoodExplorer::FeasibleMove(const FLP_Output& st, const FLP_Change& mv) const
 {
   if ( mv.new_w == mv.old_w1 
@@ -417,40 +776,12 @@ bool FLP_ChangeNeighborhoodExplorer::AnyNextMove(const FLP_Output& st, FLP_Chang
 
 CostType FLP_ChangeDeltaSupply::ComputeDeltaCost(const FLP_Output& st, const FLP_Change& mv) const
 {
-  CostType cost = 0;
-  cost += mv.new_q * in.SupplyCost(mv.store,mv.new_w);
-  if (mv.pos == Position::FIRST)
-    {
-      cost -= st.FirstQuantity(mv.store) * in.SupplyCost(mv.store,mv.old_w1);
-      // rebalance delta cost (0 if mv.new_q == st.FirstQuantity(mv.store))
-      cost += (st.FirstQuantity(mv.store) - mv.new_q) * in.SupplyCost(mv.store,mv.old_w2); // positive or negative
-    } 
-  else
-    {
-      if (mv.old_w2 != -1)
-        cost -= st.SecondQuantity(mv.store) * in.SupplyCost(mv.store,mv.old_w2);
-      // rebalance delta cost (0 if mv.new_q == st.SecondQuantity(mv.store))
-      cost += (st.SecondQuantity(mv.store) - mv.new_q) * in.SupplyCost(mv.store,mv.old_w1);
-    } 
-  return cost;
+  return ChangeDeltaSupply(in,st,mv);
 }
 
 CostType FLP_ChangeDeltaOpening::ComputeDeltaCost(const FLP_Output& st, const FLP_Change& mv) const
 {
-  int cost = 0;
-  if (mv.new_q > 0 && st.Clients(mv.new_w) == 0)
-    cost += in.FixedCost(mv.new_w);
-  if (mv.pos == Position::FIRST)
-    {
-      if (st.Clients(mv.old_w1) == 1)  // remove the last client
-        cost -= in.FixedCost(mv.old_w1);
-    }
-  else
-    {
-      if (mv.old_w2 != -1 && st.Clients(mv.old_w2) == 1)  
-        cost -= in.FixedCost(mv.old_w2); 
-    }
-  return cost;
+  return ChangeDeltaOpening(in,st,mv);
 }
 
 /*****************************************************************************
@@ -494,13 +825,13 @@ ostream& operator<<(ostream& os, const FLP_Swap& mv)
 void FLP_SwapNeighborhoodExplorer::RandomMove2(const FLP_Output& st, FLP_Swap& mv) const
 { 
   int i;
-  int count = 0;
-  do 
+  while (true)
   {
-    mv.s1 = Random::Uniform<int>(0, in.Stores() - 1);
+    counter.Draw();
+    mv.s1 = FLP_Random::Uniform(0, in.Stores() - 1);
     if (st.SecondSupplier(mv.s1) != -1)
       { // the second is selected with probability bias + (1-bias)/2  --> (bias+1)/2
-        if (Random::Uniform<double>(0.0,1.0) <= (bias+1)/2.0)
+        if (FLP_Random::Uniform(0.0,1.0) <= (bias+1)/2.0)
           mv.pos1 = Position::SECOND;
         else
           mv.pos1 = Position::FIRST;
@@ -521,30 +852,31 @@ void FLP_SwapNeighborhoodExplorer::RandomMove2(const FLP_Output& st, FLP_Swap& m
         mv.w1 = st.SecondSupplier(mv.s1);
         mv.q1 = st.SecondQuantity(mv.s1);
       }
+    if (filtered_sampling)
+      {
+        if (DrawCompatibleSupplier(st,mv))
+          break;
+        else
+          continue;
+      }
    
     do // draw another preferred supplier of s1
       {
-        i = Random::Uniform<int>(0, in.PreferredSuppliers(mv.s1) - 1);
+        i = FLP_Random::Uniform(0, in.PreferredSuppliers(mv.s1) - 1);
         mv.w2 = in.PreferredSupplier(mv.s1, i);
       }
     while (st.Clients(mv.w2) == 0);
-    i = Random::Uniform<int>(0, st.Clients(mv.w2)-1);
+    i = FLP_Random::Uniform(0, st.Clients(mv.w2)-1);
     mv.s2 = st.Client(mv.w2,i);
     
     if (st.FirstSupplier(mv.s2) == mv.w2)
-      {
-        mv.pos2 = Position::FIRST;
-        mv.q2 = st.FirstQuantity(mv.s2);
-      }
+      SetSecondStore(st,mv,mv.s2,Position::FIRST);
     else
-      {
-        mv.pos2 = Position::SECOND;
-        mv.q2 = st.SecondQuantity(mv.s2);
-      }
-    count++;
+      SetSecondStore(st,mv,mv.s2,Position::SECOND);
+    if (FeasibleMove(st,mv))
+      break;
   }
-  while (!FeasibleMove(st,mv));
-//   cerr << count << ' ';
+  counter.Sample();
   if (mv.s2 < mv.s1)
     {
       swap(mv.s1,mv.s2);
@@ -554,60 +886,70 @@ void FLP_SwapNeighborhoodExplorer::RandomMove2(const FLP_Output& st, FLP_Swap& m
     }
 }
 
+bool FLP_SwapNeighborhoodExplorer::DrawCompatibleSupplier(const FLP_Output& st, FLP_Swap& mv) const
+{ // w2 is drawn uniformly among the non-empty preferred suppliers of s1 that can receive s1 
+  // (at least almost compatible), and the draw is kept with probability candidates/non-empty suppliers:
+  // the moves have the same probabilities of the rejection loop of RandomMove2
+  int i, w, non_empty = 0;
+  candidates.clear();
+  for (i = 0; i < in.PreferredSuppliers(mv.s1); i++)
+    {
+      w = in.PreferredSupplier(mv.s1,i);
+      if (st.Clients(w) == 0)
+        continue;
+      non_empty++;
+      if (w != mv.w1 && (st.Compatible(mv.s1,w) || st.AlmostCompatible(mv.s1,w)))
+        candidates.push_back(w);
+    }
+  i = FLP_Random::Uniform(0, max(non_empty,1) - 1);
+  if (i >= static_cast<int>(candidates.size()))
+    return false;
+  mv.w2 = candidates[i];
+  i = FLP_Random::Uniform(0, st.Clients(mv.w2)-1);
+  if (st.FirstSupplier(st.Client(mv.w2,i)) == mv.w2)
+    SetSecondStore(st,mv,st.Client(mv.w2,i),Position::FIRST);
+  else
+    SetSecondStore(st,mv,st.Client(mv.w2,i),Position::SECOND);
+  return FeasibleMove(st,mv);
+}
+
 void FLP_SwapNeighborhoodExplorer::RandomMove(const FLP_Output& st, FLP_Swap& mv) const
 { // s2 is drawn among the preferred clients of w1
   // NOTE: in the old version s2 was drawn fully randomly 
   // (less efficient because many moves are infeasible)
   int i;
-  do 
+  Position pos2;
+  while (true)
   {
-    mv.s1 = Random::Uniform<int>(0, in.Stores() - 1);
-    if (st.SecondSupplier(mv.s1) != -1)
-      {
-        if (Random::Uniform<double>(0.0,1.0) <= bias)
-          mv.pos1 = Position::SECOND;
+    DrawFirstStore(st,mv);
+    if (filtered_sampling)
+      { // the draws are counted by DrawCompatiblePartner
+        if (DrawCompatiblePartner(st,mv))
+          break;
         else
-          mv.pos1 = static_cast<Position>(Random::Uniform<int>(0,1));
-      }
-    else
-      mv.pos1 = Position::FIRST;
-    if (mv.pos1 == Position::FIRST)
-      {
-        mv.w1 = st.FirstSupplier(mv.s1);
-        mv.q1 = st.FirstQuantity(mv.s1);
-      }
-    else
-      {
-        mv.w1 = st.SecondSupplier(mv.s1);
-        mv.q1 = st.SecondQuantity(mv.s1);		
+          continue;
       }
+    counter.Draw();
     do 
       {
-        i = Random::Uniform<int>(0, in.PreferredClients(mv.w1) - 1);
+        i = FLP_Random::Uniform(0, in.PreferredClients(mv.w1) - 1);
         mv.s2 = in.PreferredClient(mv.w1, i);
       }
     while (mv.s2 == mv.s1);
     if (st.SecondSupplier(mv.s2) != -1)
       {
-        if (Random::Uniform<double>(0.0,1.0) <= bias)
-          mv.pos2 = Position::SECOND;
+        if (FLP_Random::Uniform(0.0,1.0) <= bias)
+          pos2 = Position::SECOND;
         else      
-          mv.pos2 = static_cast<Position>(Random::Uniform<int>(0,1));
-      }
-    else
-      mv.pos2 = Position::FIRST;
-    if (mv.pos2 == Position::FIRST)
-      {
-        mv.w2 = st.FirstSupplier(mv.s2);
-        mv.q2 = st.FirstQuantity(mv.s2);
+          pos2 = static_cast<Position>(FLP_Random::Uniform(0,1));
       }
     else
-      {
-        mv.w2 = st.SecondSupplier(mv.s2);
-        mv.q2 = st.SecondQuantity(mv.s2);		
-      }
+      pos2 = Position::FIRST;
+    SetSecondStore(st,mv,mv.s2,pos2);
+    if (FeasibleMove(st,mv))
+      break;
   }
-  while (!FeasibleMove(st,mv));
+  counter.Sample();
   if (mv.s2 < mv.s1)
     {
       swap(mv.s1,mv.s2);
@@ -617,6 +959,103 @@ void FLP_SwapNeighborhoodExplorer::RandomMove(const FLP_Output& st, FLP_Swap& mv
     }
 } 
 
+void FLP_SwapNeighborhoodExplorer::DrawFirstStore(const FLP_Output& st, FLP_Swap& mv) const
+{
+  mv.s1 = FLP_Random::Uniform(0, in.Stores() - 1);
+  if (st.SecondSupplier(mv.s1) != -1)
+    {
+      if (FLP_Random::Uniform(0.0,1.0) <= bias)
+        mv.pos1 = Position::SECOND;
+      else
+        mv.pos1 = static_cast<Position>(FLP_Random::Uniform(0,1));
+    }
+  else
+    mv.pos1 = Position::FIRST;
+  if (mv.pos1 == Position::FIRST)
+    {
+      mv.w1 = st.FirstSupplier(mv.s1);
+      mv.q1 = st.FirstQuantity(mv.s1);
+    }
+  else
+    {
+      mv.w1 = st.SecondSupplier(mv.s1);
+      mv.q1 = st.SecondQuantity(mv.s1);		
+    }
+}
+
+void FLP_SwapNeighborhoodExplorer::SetSecondStore(const FLP_Output& st, FLP_Swap& mv, int s2, Position pos2) const
+{
+  mv.s2 = s2;
+  mv.pos2 = pos2;
+  if (pos2 == Position::FIRST)
+    {
+      mv.w2 = st.FirstSupplier(s2);
+      mv.q2 = st.FirstQuantity(s2);
+    }
+  else
+    {
+      mv.w2 = st.SecondSupplier(s2);
+      mv.q2 = st.SecondQuantity(s2);		
+    }
+}
+
+bool FLP_SwapNeighborhoodExplorer::DrawCompatiblePartner(const FLP_Output& st, FLP_Swap& mv) const
+{ // (s2,pos2) is drawn only among the partners that give a feasible move, each with the probability of pos2 
+  // in the rejection loop of RandomMove, and the draw is kept with probability total/partner_stores (the mass of
+  // all the partners): thus the moves have exactly the probabilities of the rejection loop; each evaluation 
+  // of a partner is counted as a draw, as it costs as much as a draw of the rejection loop
+  int i, s2, partner_stores = 0, evaluations = 0;
+  double draw, total = 0.0, second_probability = bias + (1.0 - bias)/2.0;
+  partners.clear();
+  weights.clear();
+  for (i = 0; i < in.PreferredClients(mv.w1); i++)
+    {
+      s2 = in.PreferredClient(mv.w1,i);
+      if (s2 == mv.s1)
+        continue;
+      partner_stores++;
+      if (st.SecondSupplier(s2) == -1)
+        {
+          SetSecondStore(st,mv,s2,Position::FIRST);
+          evaluations++;
+          if (FeasibleMove(st,mv))
+            {
+              total += 1.0;
+              partners.push_back(make_pair(s2,Position::FIRST));
+              weights.push_back(total);
+            }
+        }
+      else
+        {
+          SetSecondStore(st,mv,s2,Position::FIRST);
+          evaluations++;
+          if (FeasibleMove(st,mv))
+            {
+              total += 1.0 - second_probability;
+              partners.push_back(make_pair(s2,Position::FIRST));
+              weights.push_back(total);
+            }
+          SetSecondStore(st,mv,s2,Position::SECOND);
+          evaluations++;
+          if (FeasibleMove(st,mv))
+            {
+              total += second_probability;
+              partners.push_back(make_pair(s2,Position::SECOND));
+              weights.push_back(total);
+            }
+        }
+    }
+  counter.Draw(max(evaluations,1));
+  draw = FLP_Random::Uniform(0.0,static_cast<double>(partner_stores));
+  if (partners.empty() || draw >= total)
+    return false;
+  i = upper_bound(weights.begin(), weights.end(), draw) - weights.begin();
+  if (i == static_cast<int>(partners.size())) // rounding
+    i--;
+  SetSecondStore(st,mv,partners[i].first,partners[i].second);
+  return true;
+}
+
 bool FLP_SwapNeighborhoodExplorer::FeasibleMove(const FLP_Output& st, const FLP_Swap& mv) const
 {
   if (mv.w1 == mv.w2)
@@ -716,8 +1155,7 @@ bool FLP_SwapNeighborhoodExplorer::AnyNextMove(const FLP_Output& st, FLP_Swap& m
 
 CostType FLP_SwapDeltaSupply::ComputeDeltaCost(const FLP_Output& st, const FLP_Swap& mv) const
 {
-  return mv.q1 * (in.SupplyCost(mv.s1,mv.w2) - in.SupplyCost(mv.s1,mv.w1))
-    + mv.q2 * (in.SupplyCost(mv.s2,mv.w1) - in.SupplyCost(mv.s2,mv.w2));
+  return SwapDeltaSupply(in,st,mv);
 }
 
 /*****************************************************************************
@@ -778,29 +1216,62 @@ ostream& operator<<(ostream& os, const FLP_Clopen& mv)
   return os;
 }
 
+bool ClopenPlanCache::Lookup(const FLP_Output& st, const FLP_Clopen& mv, bool& feasible)
+{
+  unsigned i;
+  auto it = plans.find(Key(mv));
+  lookups++;
+  if (it == plans.end() || it->second.identity != st.Identity())
+    return false;
+  const Plan& plan = it->second;
+  for (i = 0; i < plan.reads.size(); i++)
+    if (st.LastModified(plan.reads[i]) > plan.version)
+      return false;
+  hits++;
+  feasible = plan.feasible;
+  mv.transfer = plan.transfer;
+  mv.closings = plan.closings;
+  mv.openings = plan.openings;
+  return true;
+}
+
+void ClopenPlanCache::Store(const FLP_Output& st, const FLP_Clopen& mv, bool feasible, vector<int>& reads)
+{
+  Plan& plan = plans[Key(mv)];
+  sort(reads.begin(), reads.end());
+  reads.erase(unique(reads.begin(), reads.end()), reads.end());
+  plan.identity = st.Identity();
+  plan.version = st.Version();
+  plan.feasible = feasible;
+  plan.transfer = mv.transfer;
+  plan.closings = mv.closings;
+  plan.openings = mv.openings;
+  plan.reads = reads;
+}
+
 void FLP_ClopenNeighborhoodExplorer::RandomMove(const FLP_Output& st, FLP_Clopen& mv) const
 { 
   float draw;
   do 
   {
-    draw = Random::Uniform<float>(0.0,1.0);
+    draw = FLP_Random::Uniform(0.0,1.0);
     if (draw < close_rate)
       {
         mv.open_w = -1;
         do 
-          mv.close_w = Random::Uniform<int>(0, in.Warehouses() - 1);
+          mv.close_w = FLP_Random::Uniform(0, in.Warehouses() - 1);
         while (st.Closed(mv.close_w));
       }
     else if (draw < close_rate + open_rate)
       {
         mv.close_w = -1;
         do 
-          mv.open_w = Random::Uniform<int>(0, in.Warehouses() - 1);
+          mv.open_w = FLP_Random::Uniform(0, in.Warehouses() - 1);
         while (st.Open(mv.open_w));
       }
     else
       {
-        mv.index = Random::Uniform<int>(0, in.NeighborWarehousePairs() - 1);
+        mv.index = FLP_Random::Uniform(0, in.NeighborWarehousePairs() - 1);
         tie(mv.open_w,mv.close_w) = in.NeighborWarehouses(mv.index);
         if (st.Open(mv.open_w)) // if mv.open_w is open test the pair in reverse order
           swap(mv.open_w,mv.close_w);
@@ -819,19 +1290,65 @@ bool FLP_ClopenNeighborhoodExplorer::FeasibleMove(const FLP_Output& st, const FL
 {
   return 
     (mv.open_w == -1 || st.Closed(mv.open_w)) 
-    && (mv.close_w == -1 || st.Open(mv.close_w))
+    && (mv.close_w == -1 || (st.Open(mv.close_w) && !in.FixedOpen(mv.close_w)))
     && (mv.close_w != -1 || mv.open_w != -1)
-    && ComputeAndCheckInvolvedStores(st,mv); 
+    && (use_cache ? CachedInvolvedStores(st,mv) : ComputeAndCheckInvolvedStores(st,mv)); 
 } 
 
-bool FLP_ClopenNeighborhoodExplorer::ComputeAndCheckInvolvedStores(const FLP_Output& st, const FLP_Clopen& mv) const
-{  
-  int i, s, old_w, new_w, q, new_load = 0;
+bool FLP_ClopenNeighborhoodExplorer::MoveAt(const FLP_Output& st, int k, FLP_Clopen& mv) const
+{
+  if (k < in.Warehouses())
+    {
+      mv.open_w = k;
+      mv.close_w = -1;
+      mv.index = -1;
+    }
+  else if (k < 2*in.Warehouses())
+    {
+      mv.open_w = -1;
+      mv.close_w = k - in.Warehouses();
+      mv.index = -1;
+    }
+  else
+    {
+      mv.index = k - 2*in.Warehouses();
+      tie(mv.open_w,mv.close_w) = in.NeighborWarehouses(mv.index);
+      if (st.Open(mv.open_w)) // if mv.open_w is open test the pair in reverse order
+        swap(mv.open_w,mv.close_w);
+    }
+  return (mv.open_w == -1 || st.Closed(mv.open_w)) 
+    && (mv.close_w == -1 || (st.Open(mv.close_w) && !in.FixedOpen(mv.close_w)))
+    && ComputeAndCheckInvolvedStores(st,mv); 
+}
+
+bool FLP_ClopenNeighborhoodExplorer::CachedInvolvedStores(const FLP_Output& st, const FLP_Clopen& mv) const
+{
+  bool feasible;
+  if (!cache.Lookup(st,mv,feasible))
+    {
+      reads.clear();
+      feasible = ComputeAndCheckInvolvedStores(st,mv,&reads);
+      cache.Store(st,mv,feasible,reads);
+    }
+  return feasible;
+}
+
+bool FLP_ClopenNeighborhoodExplorer::ComputeAndCheckInvolvedStores(const FLP_Output& st, const FLP_Clopen& mv, vector<int>* reads) const
+{ // if reads is given, the warehouses whose state is read are appended to it (possibly more than once)
+  int i, j, s, old_w, new_w, q, new_load = 0;
   bool second_supplier_checked;
   mv.transfer.clear();
   mv.openings.clear();
   mv.closings.clear();
 
+  if (reads != nullptr)
+    {
+      if (mv.open_w != -1)
+        reads->push_back(mv.open_w);
+      if (mv.close_w != -1)
+        reads->push_back(mv.close_w);
+    }
+
   if (mv.open_w != -1)
     mv.openings.push_back(mv.open_w); // this is needed by the closing part
 
@@ -843,6 +1360,9 @@ bool FLP_ClopenNeighborhoodExplorer::ComputeAndCheckInvolvedStores(const FLP_Out
         {
           s = st.Client(mv.close_w,i);		  
           q = (mv.close_w == st.FirstSupplier(s) ? st.FirstQuantity(s) : st.SecondQuantity(s));
+          if (reads != nullptr) // BestTransfer reads (at most) all the preferred suppliers
+            for (j = 0; j < in.PreferredSuppliers(s); j++)
+              reads->push_back(in.PreferredSupplier(s,j));
           new_w = st.BestTransfer(s,mv.close_w,q,mv.openings,mv.transfer); // mv.open_w is included in openings
           if (new_w == -1)
             return false;
@@ -876,15 +1396,20 @@ bool FLP_ClopenNeighborhoodExplorer::ComputeAndCheckInvolvedStores(const FLP_Out
               q = st.SecondQuantity(s);
               second_supplier_checked = true; // don't move on (first supplier tested later)
             }
+          if (reads != nullptr)
+            reads->push_back(old_w);
           if (old_w == mv.close_w || OccursPairStoreTo(mv.transfer,s,old_w))
             continue; // do not double transfer
           if (new_load + q <= in.Capacity(mv.open_w))
             {
               if (OccurrenciesAsFrom(mv.transfer,old_w) - OccurrenciesAsTo(mv.transfer,old_w) == st.Clients(old_w) - 1)
                 { // if old_w gets closed by the move, include it without checking the cost
-                  mv.closings.push_back(old_w); 
-                  mv.transfer.push_back(Transfer(s,old_w,mv.open_w,q));
-                  new_load += q;
+                  if (!in.FixedOpen(old_w)) // (unless it must stay open)
+                    {
+                      mv.closings.push_back(old_w); 
+                      mv.transfer.push_back(Transfer(s,old_w,mv.open_w,q));
+                      new_load += q;
+                    }
                   // cerr << mv.transfer.back() << endl;      
                 }
               else if (in.SupplyCost(s,mv.open_w) < in.SupplyCost(s,old_w))
@@ -982,24 +1507,11 @@ bool FLP_ClopenNeighborhoodExplorer::AnyNextMove(const FLP_Output& st, FLP_Clope
 
 CostType FLP_ClopenDeltaSupply::ComputeDeltaCost(const FLP_Output& st, const FLP_Clopen& mv) const
 { 
-  int cost = 0;
-  unsigned i;
-  for (i = 0; i < mv.transfer.size(); i++)
-  {
-    cost += mv.transfer[i].quantity * 
-      (in.SupplyCost(mv.transfer[i].store,mv.transfer[i].to_w) 
-       - in.SupplyCost(mv.transfer[i].store,mv.transfer[i].from_w));
-  }
-  return cost;
+  return ClopenDeltaSupply(in,st,mv);
 }
 
 CostType FLP_ClopenDeltaOpening::ComputeDeltaCost(const FLP_Output& st, const FLP_Clopen& mv) const 
 { 
-  int cost = 0;
-  for (unsigned i = 0; i < mv.closings.size(); i++)
-    cost -= in.FixedCost(mv.closings[i]);
-  for (unsigned i = 0; i < mv.openings.size(); i++)
-    cost += in.FixedCost(mv.openings[i]);
-  return cost;
+  return ClopenDeltaOpening(in,st,mv);
 }
 
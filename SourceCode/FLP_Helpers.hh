@@ -3,10 +3,26 @@
 #define FLP_HELPERS_HH
 
 #include "FLP_Output.hh"
+#include "FLP_Random.hh"
+#include <unordered_map>
+#include <functional>
 #include <easylocal.hh>
 
 using namespace EasyLocal::Core;
 
+class FLP_ConstructionError : public runtime_error
+{ // no initial state can be built: the capacities cannot cover the demands (reason "infeasible"), or the
+  // greedy construction is still stuck after its restarts ("stuck"), or it has been stopped ("interrupted", see
+  // FLP_SolutionManager::SetStop); the details are the other members of the JSON object that reports it
+public:
+  FLP_ConstructionError(const string& r, const string& d) 
+    : runtime_error("Greedy construction " + r + " (" + d + ")"), reason(r), details(d) {}
+  const string& Reason() const { return reason; }
+  const string& Details() const { return details; }
+private:
+  string reason, details;
+};
+
 /***************************************************************************
  * Solution Manager 
  ***************************************************************************/
@@ -14,13 +30,38 @@ using namespace EasyLocal::Core;
 class FLP_SolutionManager : public SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>> 
 {
 public:
-  FLP_SolutionManager(const FLP_Input &);
+  FLP_SolutionManager(const FLP_Input &, bool check_capacity = true);
   void RandomState(FLP_Output& out) override;   
-  void GreedyState(FLP_Output& out) override;   
+  void GreedyState(FLP_Output& out) override; // throws FLP_ConstructionError
   void DumpState(const FLP_Output& out, ostream& os) const override;   
   bool CheckConsistency(const FLP_Output& st) const override;
   void PrettyPrintOutput(const FLP_Output& st, string filename) const override;
+  void CheckCapacity(); // throws FLP_ConstructionError if the capacities cannot cover the demands (done once)
+  // a solution of the instance before a delta is made feasible again: the stores whose supply is no longer 
+  // valid (demand, preferences, incompatibilities, or the capacity of one of their warehouses) are removed
+  // and placed again at the cheapest position; returns the number of stores placed again, -1 on failure;
+  // a state just read (operator>>) has valid counters, and the repair is O(S) without the rebuild
+  int RepairState(FLP_Output& out, bool rebuild = true);
+  unsigned GreedyRepairs() const { return greedy_repairs; } // stores placed by RepairStore
+  unsigned GreedyRestarts() const { return greedy_restarts; }
+  // GreedyState and RandomState throw FLP_ConstructionError("interrupted") as soon as stop returns true
+  // (checked at each store placed); none by default
+  void SetStop(function<bool()> s) { stop = s; }
 protected:
+  void CheckStop(int unserved_stores) const;
+  // the construction stalls when no warehouse has room (and compatibility) for the rest of a store: the 
+  // store is then placed by ejection chains, moving whole supplies of other stores out of a preferred
+  // warehouse (to warehouses freed in turn, up to MAX_CHAIN_DEPTH levels); the moves are undone if they fail
+  static const int MAX_CHAIN_DEPTH = 3;
+  bool RepairStore(FLP_Output& out, int s);
+  bool Relocate(FLP_Output& out, int c, int w, int depth); // move the supply of c out of w
+  bool Free(FLP_Output& out, int w, int amount, int depth); // make at least amount of room in w
+  bool Place(FLP_Output& out, int s); // at the cheapest position with room, by RepairStore otherwise
+  int stuck_store;
+  vector<bool> in_chain; // warehouses that cannot receive supplies in the current chain
+  bool capacity_checked;
+  unsigned greedy_repairs, greedy_restarts;
+  function<bool()> stop;
 }; 
 
 class FLP_Supply : public CostComponent<FLP_Input,FLP_Output,CostType> 
@@ -40,6 +81,18 @@ public:
   void PrintViolations(const FLP_Output& st, ostream& os = cout) const override;
 };
 
+class FLP_Total : public CostComponent<FLP_Input,FLP_Output,CostType> 
+{ // supply plus opening costs: it replaces the two components when the fused delta costs are used
+public:
+  FLP_Total(const FLP_Input & in, int w, bool hard, const FLP_Supply& sc, const FLP_Opening& oc) 
+    : CostComponent<FLP_Input,FLP_Output,CostType>(in,w,hard,"FLP_Total"), supply(sc), opening(oc) {}
+  CostType ComputeCost(const FLP_Output& st) const override { return supply.ComputeCost(st) + opening.ComputeCost(st); }
+  void PrintViolations(const FLP_Output& st, ostream& os = cout) const override;
+protected:
+  const FLP_Supply& supply;
+  const FLP_Opening& opening;
+};
+
 /***************************************************************************
  * FLP_Change Neighborhood Explorer:
  ***************************************************************************/
@@ -61,20 +114,81 @@ class FLP_Change
   FLP_Change() { store = -1; }
 };
 
+class SamplingCounter
+{ // instrumentation of the rejection loops of the RandomMove methods
+public:
+  void Draw(unsigned long long n = 1) const { draws += n; }
+  void Sample() const { samples++; }
+  unsigned long long Draws() const { return draws; }
+  unsigned long long Samples() const { return samples; }
+  double WastedDrawsPerSample() const { return samples == 0 ? 0.0 : static_cast<double>(draws - samples)/samples; }
+private:
+  mutable unsigned long long draws = 0, samples = 0;
+};
+
+class FenwickTree
+{ // prefix sums of non-negative integer weights, updated and searched in O(log n)
+public:
+  FenwickTree(int n) : tree(n+1,0) { total = 0; for (top = 1; 2*top <= n; top *= 2); }
+  void Add(int i, int delta) { total += delta; for (i++; i < static_cast<int>(tree.size()); i += i & -i) tree[i] += delta; }
+  int Total() const { return total; }
+  int Find(int& r) const; // the element that contains the unit r of the total, r becomes its offset inside it
+private:
+  vector<int> tree;
+  int total, top;
+};
+
+class SupplierMasks
+{ // for each store and each position, the bitmask of the preferred suppliers that give a feasible Change move,
+  // and for each store the number of its feasible moves, summed by a Fenwick tree; a store becomes dirty when
+  // the load of one of its suppliers or of its preferred suppliers is modified, and its weight is then the
+  // upper bound 2*PreferredSuppliers(s) until its masks are recomputed (when it is drawn)
+public:
+  SupplierMasks(const FLP_Input& in);
+  void Synchronize(const FLP_Output& st); // marks dirty the stores affected by the modifications of st since the last call
+  bool Dirty(int s) const { return dirty[s]; }
+  int Count(int s) const { return count[s]; }
+  int Total() const { return weights.Total(); }
+  int Find(int& r) const { return weights.Find(r); }
+  void Clear(int s);
+  void Set(int s, Position pos, int i) { bits[Word(s,pos) + i/64] |= 1ULL << (i % 64); }
+  bool Test(int s, Position pos, int i) const { return (bits[Word(s,pos) + i/64] >> (i % 64)) & 1ULL; }
+  void SetClean(int s); // the count of s is recomputed from its masks
+  void Select(int s, int r, Position& pos, int& i) const; // the r-th feasible move of s (FIRST masks first)
+private:
+  void MarkDirty(int s);
+  unsigned Word(int s, Position pos) const { return first_word[s] + (pos == Position::FIRST ? 0 : words[s]); }
+  const FLP_Input& in;
+  vector<unsigned> first_word; // first word of the masks of each store (FIRST, then SECOND)
+  vector<int> words; // number of words of each mask of the store
+  vector<unsigned long long> bits;
+  vector<int> count; // feasible moves of each store (the upper bound if it is dirty)
+  vector<bool> dirty;
+  FenwickTree weights;
+  unsigned long long seen_identity, seen_version; // of the state at the last synchronization
+};
+
 class FLP_ChangeNeighborhoodExplorer
   : public NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Change,DefaultCostStructure<CostType>> 
 {
 public:
-  FLP_ChangeNeighborhoodExplorer(const FLP_Input & pin, SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>>& psm)  
-    : NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Change,DefaultCostStructure<CostType>>(pin, psm, "FLP_ChangeNeighborhoodExplorer") {} 
+  FLP_ChangeNeighborhoodExplorer(const FLP_Input & pin, SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>>& psm, bool fs = false)  
+    : NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Change,DefaultCostStructure<CostType>>(pin, psm, "FLP_ChangeNeighborhoodExplorer"),
+      masks(pin) { filtered_sampling = fs; } 
   void RandomMove(const FLP_Output&, FLP_Change&) const override;          
   bool FeasibleMove(const FLP_Output&, const FLP_Change&) const override;  
   void MakeMove(FLP_Output&, const FLP_Change&) const override;             
   void FirstMove(const FLP_Output&, FLP_Change&) const override;  
   bool NextMove(const FLP_Output&, FLP_Change&) const override;   
+  const SamplingCounter& Sampling() const { return counter; }
 protected:
   void AnyFirstMove(const FLP_Output&, FLP_Change&) const;  
   bool AnyNextMove(const FLP_Output&, FLP_Change&) const;   
+  void FilteredRandomMove(const FLP_Output&, FLP_Change&) const;
+  void RefreshMasks(const FLP_Output&, int s) const;
+  bool filtered_sampling; // draw the new supplier only among the feasible ones
+  mutable SupplierMasks masks;
+  SamplingCounter counter;
 };
 
 class FLP_ChangeDeltaSupply
@@ -119,18 +233,28 @@ class FLP_SwapNeighborhoodExplorer
   : public NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Swap,DefaultCostStructure<CostType>> 
 {
 public:
-  FLP_SwapNeighborhoodExplorer(const FLP_Input & pin, SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>>& psm, double b = 0.0)  
-    : NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Swap,DefaultCostStructure<CostType>>(pin, psm, "FLP_SwapNeighborhoodExplorer") { bias = b; } 
+  FLP_SwapNeighborhoodExplorer(const FLP_Input & pin, SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>>& psm, double b = 0.0, bool fs = false)  
+    : NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Swap,DefaultCostStructure<CostType>>(pin, psm, "FLP_SwapNeighborhoodExplorer") { bias = b; filtered_sampling = fs; } 
   void RandomMove(const FLP_Output&, FLP_Swap&) const override;          
   void RandomMove2(const FLP_Output&, FLP_Swap&) const;          
   bool FeasibleMove(const FLP_Output&, const FLP_Swap&) const override;  
   void MakeMove(FLP_Output&, const FLP_Swap&) const override;             
   void FirstMove(const FLP_Output&, FLP_Swap&) const override;  
   bool NextMove(const FLP_Output&, FLP_Swap&) const override;   
+  const SamplingCounter& Sampling() const { return counter; }
 protected:
   void AnyFirstMove(const FLP_Output&, FLP_Swap&) const;  
   bool AnyNextMove(const FLP_Output&, FLP_Swap&) const;   
+  void DrawFirstStore(const FLP_Output&, FLP_Swap&) const;
+  void SetSecondStore(const FLP_Output&, FLP_Swap&, int s2, Position pos2) const;
+  bool DrawCompatiblePartner(const FLP_Output&, FLP_Swap&) const;
+  bool DrawCompatibleSupplier(const FLP_Output&, FLP_Swap&) const;
   double bias;
+  bool filtered_sampling; // draw the partner only among the compatible ones
+  SamplingCounter counter;
+  mutable vector<pair<int,Position>> partners; // scratch: feasible partners of the current draw
+  mutable vector<double> weights;              // scratch: cumulative probability of the partners
+  mutable vector<int> candidates;              // scratch: candidate suppliers of the current draw
 };
 
 class FLP_SwapDeltaSupply
@@ -197,23 +321,59 @@ class FLP_Clopen
   FLP_Clopen() { open_w = -1; close_w = -1; index = -1; }
 };
 
+class ClopenPlanCache
+{ // transfer plans of the Clopen moves already evaluated, keyed by the pair (open_w, close_w): a plan 
+  // is reused while none of the warehouses read to compute it has been modified (FLP_Output::LastModified);
+  // the changes of the stores are covered as well, because they modify the loads of their suppliers
+public:
+  ClopenPlanCache(const FLP_Input& in) : warehouses(in.Warehouses()) {}
+  bool Lookup(const FLP_Output& st, const FLP_Clopen& mv, bool& feasible); // true if valid (the plan is copied in mv)
+  void Store(const FLP_Output& st, const FLP_Clopen& mv, bool feasible, vector<int>& reads);
+  unsigned long long Lookups() const { return lookups; }
+  unsigned long long Hits() const { return hits; }
+  double HitRate() const { return lookups == 0 ? 0.0 : static_cast<double>(hits)/lookups; }
+private:
+  struct Plan 
+  { 
+    unsigned long long identity, version; // of the state when computed
+    bool feasible;
+    vector<Transfer> transfer;
+    vector<int> closings, openings;
+    vector<int> reads; // warehouses read by the computation
+  };
+  long long Key(const FLP_Clopen& mv) const { return (mv.open_w + 1) * (warehouses + 1LL) + mv.close_w + 1; }
+  int warehouses;
+  unordered_map<long long,Plan> plans;
+  unsigned long long lookups = 0, hits = 0;
+};
+
 class FLP_ClopenNeighborhoodExplorer
   : public NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Clopen,DefaultCostStructure<CostType>> 
 {
 public:
-  FLP_ClopenNeighborhoodExplorer(const FLP_Input & pin, SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>>& psm, double c_r, double o_r)  
-    : NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Clopen,DefaultCostStructure<CostType>>(pin, psm, "FLP_ClopenNeighborhoodExplorer") 
-  { close_rate = c_r; open_rate = o_r; } 
+  FLP_ClopenNeighborhoodExplorer(const FLP_Input & pin, SolutionManager<FLP_Input,FLP_Output,DefaultCostStructure<CostType>>& psm, double c_r, double o_r, bool uc = false)  
+    : NeighborhoodExplorer<FLP_Input,FLP_Output,FLP_Clopen,DefaultCostStructure<CostType>>(pin, psm, "FLP_ClopenNeighborhoodExplorer"),
+      cache(pin) { close_rate = c_r; open_rate = o_r; use_cache = uc; } 
   void RandomMove(const FLP_Output&, FLP_Clopen&) const override;          
   bool FeasibleMove(const FLP_Output&, const FLP_Clopen&) const override;  
   void MakeMove(FLP_Output&, const FLP_Clopen&) const override;             
   void FirstMove(const FLP_Output&, FLP_Clopen&) const override;  
   bool NextMove(const FLP_Output&, FLP_Clopen&) const override;   
+  const ClopenPlanCache& Cache() const { return cache; }
+  // direct access to the moves in the order of FirstMove/NextMove (opening, closing, and flip moves): 
+  // MoveAt sets mv to the k-th one and checks its feasibility, without the cache (so it can be called
+  // concurrently with distinct moves)
+  int Moves() const { return 2*in.Warehouses() + in.NeighborWarehousePairs(); }
+  bool MoveAt(const FLP_Output& st, int k, FLP_Clopen& mv) const;
 protected:
   void AnyFirstMove(const FLP_Output&, FLP_Clopen&) const;  
   bool AnyNextMove(const FLP_Output&, FLP_Clopen&) const;   
-  bool ComputeAndCheckInvolvedStores(const FLP_Output&, const FLP_Clopen&) const; 
+  bool ComputeAndCheckInvolvedStores(const FLP_Output&, const FLP_Clopen&, vector<int>* reads = nullptr) const; 
+  bool CachedInvolvedStores(const FLP_Output&, const FLP_Clopen&) const; 
   double close_rate, open_rate;
+  bool use_cache; // reuse the plans of the moves evaluated before, if still valid
+  mutable ClopenPlanCache cache;
+  mutable vector<int> reads;
 };
 
 class FLP_ClopenDeltaSupply
@@ -235,4 +395,95 @@ public:
   {}
   CostType ComputeDeltaCost(const FLP_Output& st, const FLP_Clopen& mv) const override;
 };
+
+/***************************************************************************
+ * Delta cost kernels: shared by the per-component delta costs and by the 
+ * fused one, which computes supply and opening in a single pass through a 
+ * single (virtual) call per move
+ ***************************************************************************/
+
+inline CostType ChangeDeltaSupply(const FLP_Input& in, const FLP_Output& st, const FLP_Change& mv)
+{
+  CostType cost = 0;
+  cost += mv.new_q * in.SupplyCost(mv.store,mv.new_w);
+  if (mv.pos == Position::FIRST)
+    {
+      cost -= st.FirstQuantity(mv.store) * in.SupplyCost(mv.store,mv.old_w1);
+      // rebalance delta cost (0 if mv.new_q == st.FirstQuantity(mv.store))
+      cost += (st.FirstQuantity(mv.store) - mv.new_q) * in.SupplyCost(mv.store,mv.old_w2); // positive or negative
+    } 
+  else
+    {
+      if (mv.old_w2 != -1)
+        cost -= st.SecondQuantity(mv.store) * in.SupplyCost(mv.store,mv.old_w2);
+      // rebalance delta cost (0 if mv.new_q == st.SecondQuantity(mv.store))
+      cost += (st.SecondQuantity(mv.store) - mv.new_q) * in.SupplyCost(mv.store,mv.old_w1);
+    } 
+  return cost;
+}
+
+inline CostType ChangeDeltaOpening(const FLP_Input& in, const FLP_Output& st, const FLP_Change& mv)
+{
+  CostType cost = 0;
+  if (mv.new_q > 0 && st.Clients(mv.new_w) == 0)
+    cost += in.FixedCost(mv.new_w);
+  if (mv.pos == Position::FIRST)
+    {
+      if (st.Clients(mv.old_w1) == 1)  // remove the last client
+        cost -= in.FixedCost(mv.old_w1);
+    }
+  else
+    {
+      if (mv.old_w2 != -1 && st.Clients(mv.old_w2) == 1)  
+        cost -= in.FixedCost(mv.old_w2); 
+    }
+  return cost;
+}
+
+inline CostType SwapDeltaSupply(const FLP_Input& in, const FLP_Output& st, const FLP_Swap& mv)
+{
+  return mv.q1 * (in.SupplyCost(mv.s1,mv.w2) - in.SupplyCost(mv.s1,mv.w1))
+    + mv.q2 * (in.SupplyCost(mv.s2,mv.w1) - in.SupplyCost(mv.s2,mv.w2));
+}
+
+inline CostType ClopenDeltaSupply(const FLP_Input& in, const FLP_Output& st, const FLP_Clopen& mv)
+{
+  CostType cost = 0;
+  for (unsigned i = 0; i < mv.transfer.size(); i++)
+    cost += mv.transfer[i].quantity * 
+      (in.SupplyCost(mv.transfer[i].store,mv.transfer[i].to_w) 
+       - in.SupplyCost(mv.transfer[i].store,mv.transfer[i].from_w));
+  return cost;
+}
+
+inline CostType ClopenDeltaOpening(const FLP_Input& in, const FLP_Output& st, const FLP_Clopen& mv)
+{
+  CostType cost = 0;
+  for (unsigned i = 0; i < mv.closings.size(); i++)
+    cost -= in.FixedCost(mv.closings[i]);
+  for (unsigned i = 0; i < mv.openings.size(); i++)
+    cost += in.FixedCost(mv.openings[i]);
+  return cost;
+}
+
+inline CostType FusedDelta(const FLP_Input& in, const FLP_Output& st, const FLP_Change& mv)
+{ return ChangeDeltaSupply(in,st,mv) + ChangeDeltaOpening(in,st,mv); }
+
+inline CostType FusedDelta(const FLP_Input& in, const FLP_Output& st, const FLP_Swap& mv)
+{ return SwapDeltaSupply(in,st,mv); }
+
+inline CostType FusedDelta(const FLP_Input& in, const FLP_Output& st, const FLP_Clopen& mv)
+{ return ClopenDeltaSupply(in,st,mv) + ClopenDeltaOpening(in,st,mv); }
+
+template <class Move>
+class FLP_FusedDelta
+  : public DeltaCostComponent<FLP_Input,FLP_Output,Move,CostType>
+{ // delta cost of FLP_Total for the given move type
+public:
+  FLP_FusedDelta(const FLP_Input & in, FLP_Total& cc) 
+    : DeltaCostComponent<FLP_Input,FLP_Output,Move,CostType>(in,cc,"FLP_FusedDelta") 
+  {}
+  CostType ComputeDeltaCost(const FLP_Output& st, const Move& mv) const override final 
+  { return FusedDelta(this->in,st,mv); }
+};
 #endif
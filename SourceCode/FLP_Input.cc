@@ -3,33 +3,59 @@
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <sys/resource.h>
 #include "FLP_Input.hh"
 
-FLP_Input::FLP_Input(string file_name, double sqrt_ratio_preferred, int cost_diff_threshold)
+static void CheckAmountOfGoods(int q)
+{
+  if (q == 1)
+    throw invalid_argument("The amount of goods cannot be equal to 1 (it cannot be split into two suppliers)");
+  if (q < 1)
+    throw invalid_argument("The amount of goods must be positive");
+}
+
+static void CheckCapacity(int c)
+{
+  if (c < 0)
+    throw invalid_argument("The capacity cannot be negative");
+}
+
+FLP_Input::FLP_Input(string file_name, double sqrt_ratio_preferred, int diff_threshold, bool sparse,
+                     bool renumber)
+  : sparse_costs(sparse), sqrt_ratio(sqrt_ratio_preferred), cost_diff_threshold(diff_threshold), batch(false),
+    renumbered(renumber)
 {  
   const int MAX_DIM = 100;
-  int w, s, i, preferred;
+  int w, s, i;
   char ch, buffer[MAX_DIM];
 
   ifstream is(file_name);
   if(!is)
-  {
-    cerr << "Cannot open input file " <<  file_name << endl;
-    exit(1);
-  }
+    throw invalid_argument("Cannot open input file " + file_name);
   
   is >> buffer >> ch >> warehouses >> ch;
   is >> buffer >> ch >> stores >> ch;
   
   capacity.resize(warehouses);
   fixed_cost.resize(warehouses);
+  closed.resize(warehouses,false);
   amount_of_goods.resize(stores);
-  supply_cost.resize(stores,vector<CostType>(warehouses));
+  if (sparse_costs)
+    {
+      fallback_cost.resize(stores);
+      fallback_width.resize(stores);
+    }
+  else
+    supply_cost.resize(stores,vector<CostType>(warehouses));
   
   // read capacity
   is.ignore(MAX_DIM,'['); // read "... Capacity = ["
   for (w = 0; w < warehouses; w++)
-    is >> capacity[w] >> ch;
+    {
+      is >> capacity[w] >> ch;
+      CheckCapacity(capacity[w]);
+    }
   
   // read fixed costs  
   is.ignore(MAX_DIM,'['); // read "... FixedCosts = ["
@@ -41,16 +67,28 @@ FLP_Input::FLP_Input(string file_name, double sqrt_ratio_preferred, int cost_dif
   for (s = 0; s < stores; s++)
     {
       is >> amount_of_goods[s] >> ch;
-      if (amount_of_goods[s] == 1)
-        throw invalid_argument("The amount of goods cannot be equal to 1 (it cannot be split into two suppliers)");
+      CheckAmountOfGoods(amount_of_goods[s]);
     }
-  // read supply costs
+  // read supply costs (and compute the preferred facilities of each store)
+  vector<CostType> row(warehouses);
+  vector<pair<int,CostType>> suppliers;
+  // preferred can't be more than the number of facilities
+  preferred = min(static_cast<int>(sqrt_ratio_preferred * sqrt(warehouses) + 0.5), warehouses);                   
+  total_supply_cost = 0.0;
   is.ignore(MAX_DIM,'['); // read "... SupplyCost = ["
   is >> ch; // read first '|'
   for (s = 0; s < stores; s++)
   {	 
     for (w = 0; w < warehouses; w++)
-      is >> supply_cost[s][w] >> ch;
+      {
+        is >> row[w] >> ch;
+        total_supply_cost += row[w];
+      }
+    ComputePreferredSuppliers(s, row, suppliers);
+    if (sparse_costs)
+      SetFallbackCosts(s, row);
+    else
+      supply_cost[s] = row;
   }
   is >> ch >> ch;
   
@@ -58,97 +96,616 @@ FLP_Input::FLP_Input(string file_name, double sqrt_ratio_preferred, int cost_dif
   int s2, num_incompatibilities;
   is >> buffer >> ch >> num_incompatibilities >> ch;
   incompatibilities.resize(num_incompatibilities);
-  incompatibility_list.resize(stores);
   is.ignore(MAX_DIM,'['); // read "... IncompatiblePairs = ["
+  vector<int> list_size(stores,0);
   for (i = 0; i < num_incompatibilities; i++)
   {
     is >> ch >> s >> ch >> s2;	  
     incompatibilities[i].first = s - 1;
     incompatibilities[i].second = s2 - 1;
-    incompatibility_list[s-1].push_back(s2-1);
-    incompatibility_list[s2-1].push_back(s-1);    
+    list_size[s-1]++;
+    list_size[s2-1]++;
   }
   is >> ch >> ch;
+  incompatibility_list.Allocate(list_size);
+  fill(list_size.begin(), list_size.end(), 0); // now used as insertion point of each list
+  for (i = 0; i < num_incompatibilities; i++)
+  {
+    s = incompatibilities[i].first;
+    s2 = incompatibilities[i].second;
+    incompatibility_list.At(s,list_size[s]++) = s2;
+    incompatibility_list.At(s2,list_size[s2]++) = s;
+  }
+  for (s = 0; s < stores; s++)
+    sort(incompatibility_list.Begin(s), incompatibility_list.End(s));
 
-  // compute preferred facilities
-  preferred_suppliers.resize(stores);
-  preferred_clients.resize(warehouses);
-  preference.resize(stores,vector<bool>(warehouses,false));
-  vector<pair<int,CostType>> suppliers;
-  // preferred can't be more than the number of facilities
-  preferred = min(static_cast<int>(sqrt_ratio_preferred * sqrt(warehouses) + 0.5), warehouses);                   
+  // compute derived data (on the renumbered stores and warehouses, if requested)
+  original_store.resize(stores);
+  original_warehouse.resize(warehouses);
+  for (s = 0; s < stores; s++)
+    original_store[s] = s;
+  for (w = 0; w < warehouses; w++)
+    original_warehouse[w] = w;
+  if (renumbered)
+    {
+      ComputePreferredClients();
+      ComputeRenumbering();
+      Renumber();
+    }
+  internal_store.resize(stores);
+  internal_warehouse.resize(warehouses);
+  for (s = 0; s < stores; s++)
+    internal_store[original_store[s]] = s;
+  for (w = 0; w < warehouses; w++)
+    internal_warehouse[original_warehouse[w]] = w;
+  fixed_open.resize(warehouses,false);
+  ComputePreferredClients();
+  ComputeNeighborWarehouses();
+}
+
+void FLP_Input::Reduce(function<bool(int,int)> pruned, const vector<bool>& fixed)
+{ 
+  int s, i, w;
+  FlatLists<int> new_suppliers, new_sorted_suppliers;
+  FlatLists<CostType> new_costs, new_sorted_costs;
 
-  int best_cost;
   for (s = 0; s < stores; s++)
+    { // the cheapest supplier is kept anyway
+      new_suppliers.NewList();
+      new_costs.NewList();
+      for (i = 0; i < PreferredSuppliers(s); i++)
+        if (i == 0 || !pruned(s,PreferredSupplier(s,i))) 
+          {
+            new_suppliers.Add(PreferredSupplier(s,i));
+            new_costs.Add(PreferredSupplierCost(s,i));
+          }
+      new_sorted_suppliers.NewList();
+      if (sparse_costs)
+        new_sorted_costs.NewList();
+      for (i = 0; i < sorted_suppliers.Size(s); i++)
+        {
+          w = sorted_suppliers.At(s,i);
+          if (w == PreferredSupplier(s,0) || !pruned(s,w))
+            {
+              new_sorted_suppliers.Add(w);
+              if (sparse_costs)
+                new_sorted_costs.Add(sorted_costs.At(s,i));
+            }
+        }
+    }
+  preferred_suppliers = move(new_suppliers);
+  preferred_costs = move(new_costs);
+  sorted_suppliers = move(new_sorted_suppliers);
+  sorted_costs = move(new_sorted_costs);
+  fixed_open = fixed;
+  ComputePreferredClients();
+  ComputeNeighborWarehouses();
+}
+
+void FLP_Input::SetAmountOfGoods(int s, int q)
+{
+  CheckAmountOfGoods(q);
+  amount_of_goods[s] = q;
+}
+
+void FLP_Input::SetCapacity(int w, int c)
+{
+  CheckCapacity(c);
+  if (closed[w] && c > 0)
+    throw invalid_argument("A closed warehouse cannot get capacity");
+  capacity[w] = c;
+}
+
+void FLP_Input::SetFixedCost(int w, int c)
+{
+  fixed_cost[w] = c;
+}
+
+void FLP_Input::SetSupplyCosts(int s, const vector<CostType>& row)
+{
+  changed_rows[s] = row;
+  if (!batch)
+    ApplyChanges();
+}
+
+void FLP_Input::AddIncompatibility(int s1, int s2)
+{
+  if (s1 == s2)
+    throw invalid_argument("A store cannot be incompatible with itself");
+  if (ChangedIncompatible(s1,s2))
+    return;
+  incompatibilities.push_back(make_pair(s1,s2));
+  for (pair<int,int> p : {make_pair(s1,s2), make_pair(s2,s1)})
     {
-      suppliers.clear();
+      vector<int>& list = ChangedIncompatibilities(p.first);
+      list.insert(lower_bound(list.begin(), list.end(), p.second), p.second);
+    }
+  if (!batch)
+    ApplyChanges();
+}
+
+void FLP_Input::RemoveIncompatibility(int s1, int s2)
+{
+  if (!ChangedIncompatible(s1,s2))
+    return;
+  incompatibilities.erase(remove_if(incompatibilities.begin(), incompatibilities.end(), 
+                                    [s1, s2](const pair<int,int>& p) { return (p.first == s1 && p.second == s2) 
+                                                                        || (p.first == s2 && p.second == s1); }),
+                          incompatibilities.end());
+  for (pair<int,int> p : {make_pair(s1,s2), make_pair(s2,s1)})
+    RemoveElement(ChangedIncompatibilities(p.first), p.second);
+  if (!batch)
+    ApplyChanges();
+}
+
+vector<int>& FLP_Input::ChangedIncompatibilities(int s)
+{
+  auto it = changed_incompatibilities.find(s);
+  if (it == changed_incompatibilities.end())
+    it = changed_incompatibilities.emplace(s, vector<int>(incompatibility_list.Begin(s), incompatibility_list.End(s))).first;
+  return it->second;
+}
+
+bool FLP_Input::ChangedIncompatible(int s1, int s2)
+{
+  auto it = changed_incompatibilities.find(s1);
+  if (it == changed_incompatibilities.end())
+    return Incompatible(s1,s2);
+  return binary_search(it->second.begin(), it->second.end(), s2);
+}
+
+void FLP_Input::CloseWarehouse(int w)
+{ // the stores that preferred w get the next cheapest supplier in its place (those whose costs have been
+  // changed in the same batch are recomputed anyway)
+  int v;
+  vector<CostType> row(warehouses);
+  closed[w] = true;
+  capacity[w] = 0;
+  fixed_open[w] = false;
+  for (int s : vector<int>(preferred_clients.Begin(w), preferred_clients.End(w)))
+    if (changed_rows.find(s) == changed_rows.end())
+      {
+        for (v = 0; v < warehouses; v++)
+          row[v] = SupplyCost(s,v);
+        changed_rows[s] = row;
+      }
+  if (!batch)
+    ApplyChanges();
+}
+
+void FLP_Input::ApplyChanges()
+{ // the lists of the changed stores are recomputed, then those of the warehouses that enter or leave them
+  // (or change their cost), and each FlatLists is rebuilt once
+  int i, s, w;
+  vector<pair<int,CostType>> suppliers;
+  vector<int> list, affected;
+  vector<CostType> costs;
+  map<int,vector<int>> supplier_lists, sorted_lists, client_lists, neighbor_lists;
+  map<int,vector<CostType>> cost_lists, sorted_cost_lists;
+  for (const auto& c : changed_rows)
+    {
+      s = c.first;
+      const vector<CostType>& row = c.second;
       for (w = 0; w < warehouses; w++)
-        suppliers.push_back(make_pair(w,supply_cost[s][w]));
-      sort(suppliers.begin(), suppliers.end(), 
-           [](const pair<int,CostType>& left, const pair<int,CostType>& right) {
-             return left.second < right.second; });
-      for (i = 0; i < preferred; i++)
+        total_supply_cost += row[w] - SupplyCost(s,w);
+      affected.insert(affected.end(), sorted_suppliers.Begin(s), sorted_suppliers.End(s));
+      SelectPreferredSuppliers(row, suppliers);
+      list.clear();
+      costs.clear();
+      for (i = 0; i < static_cast<int>(suppliers.size()); i++)
+        {
+          list.push_back(suppliers[i].first);
+          costs.push_back(suppliers[i].second);
+        }
+      supplier_lists[s] = list;
+      cost_lists[s] = costs;
+      sort(suppliers.begin(), suppliers.end());
+      list.clear();
+      costs.clear();
+      for (i = 0; i < static_cast<int>(suppliers.size()); i++)
+        {
+          list.push_back(suppliers[i].first);
+          costs.push_back(suppliers[i].second);
+          affected.push_back(suppliers[i].first);
+        }
+      sorted_lists[s] = list;
+      if (sparse_costs)
+        {
+          sorted_cost_lists[s] = costs;
+          SetFallbackCosts(s, row);
+        }
+      else
+        supply_cost[s] = row;
+    }
+  preferred_suppliers.Replace(supplier_lists);
+  preferred_costs.Replace(cost_lists);
+  sorted_suppliers.Replace(sorted_lists);
+  sorted_costs.Replace(sorted_cost_lists);
+  sort(affected.begin(), affected.end());
+  affected.erase(unique(affected.begin(), affected.end()), affected.end());
+  for (int w : affected)
+    {
+      list.clear();
+      for (i = 0; i < PreferredClients(w); i++)
+        if (changed_rows.find(PreferredClient(w,i)) == changed_rows.end())
+          list.push_back(PreferredClient(w,i));
+      for (const auto& c : changed_rows)
+        if (Preference(c.first,w))
+          list.push_back(c.first);
+      sort(list.begin(), list.end(), [this, w](int s1, int s2) 
+           { return SupplyCost(s1,w) < SupplyCost(s2,w) || (SupplyCost(s1,w) == SupplyCost(s2,w) && s1 > s2); });
+      client_lists[w] = list;
+    }
+  preferred_clients.Replace(client_lists);
+  for (int w : affected) // only the pairs of a supplier of a changed store can have changed
+    NeighborWarehouses(w, neighbor_lists[w]);
+  neighbor_warehouses.Replace(neighbor_lists);
+  incompatibility_list.Replace(changed_incompatibilities);
+  changed_rows.clear();
+  changed_incompatibilities.clear();
+}
+
+void FLP_Input::NeighborWarehouses(int w1, vector<int>& neighbors) const
+{ // as in ComputeNeighborWarehouses, for the list of w1 only
+  int i, j, s, w2;
+  neighbors.clear();
+  for (i = 0; i < PreferredClients(w1); i++)
+    {
+      s = PreferredClient(w1,i);
+      for (j = 0; j < PreferredSuppliers(s); j++)
         {
-          w = suppliers[i].first;
-          preferred_suppliers[s].push_back(w);
-          InsertClient(w,s);   // preferred_clients[w].push_back(s);
-          preference[s][w] = true;
+          w2 = PreferredSupplier(s,j);
+          if (w2 > w1)
+            neighbors.push_back(w2);
         }
+    }
+  sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(unique(neighbors.begin(), neighbors.end()), neighbors.end());
+}
+
+void FLP_Input::ComputePreferredSuppliers(int s, const vector<CostType>& row, vector<pair<int,CostType>>& suppliers)
+{ // the lists of s are appended (suppliers is a buffer)
+  int i;
+  SelectPreferredSuppliers(row, suppliers);
+  preferred_suppliers.NewList();
+  preferred_costs.NewList();
+  for (i = 0; i < static_cast<int>(suppliers.size()); i++)
+    {
+      preferred_suppliers.Add(suppliers[i].first);
+      preferred_costs.Add(suppliers[i].second);
+    }
+  // slot index: the same suppliers, ordered by index
+  sort(suppliers.begin(), suppliers.end());
+  sorted_suppliers.NewList();
+  for (i = 0; i < static_cast<int>(suppliers.size()); i++)
+    sorted_suppliers.Add(suppliers[i].first);
+  if (sparse_costs)
+    {
+      sorted_costs.NewList();
+      for (i = 0; i < static_cast<int>(suppliers.size()); i++)
+        sorted_costs.Add(suppliers[i].second);
+    }
+}
+
+void FLP_Input::SelectPreferredSuppliers(const vector<CostType>& row, vector<pair<int,CostType>>& suppliers) const
+{ // the preferred suppliers are the cheapest ones, plus the ones whose cost differs from the 
+  // minimum at most by cost_diff_threshold (ordered by cost); closed warehouses are skipped
+  int w, n;
+  CostType best_cost;
+  suppliers.clear();
+  for (w = 0; w < warehouses; w++)
+    if (!closed[w])
+      suppliers.push_back(make_pair(w,row[w]));
+  sort(suppliers.begin(), suppliers.end(), 
+       [](const pair<int,CostType>& left, const pair<int,CostType>& right) {
+         return left.second < right.second; });
+  n = min(preferred, static_cast<int>(suppliers.size()));
+  if (n > 0)
+    {
       best_cost = suppliers[0].second;
-      for (; i < warehouses; i++)
-        if (suppliers[i].second <= best_cost + cost_diff_threshold)
-          {
-            w = suppliers[i].first;
-            preferred_suppliers[s].push_back(w);
-            InsertClient(w,s);  // preferred_clients[w].push_back(s);
-            preference[s][w] = true;
-          }
-        else
-          break;
-    }	
-
-  // cerr << "Computing neighbor warehouses...";
-  vector<vector<bool>> neighbors(warehouses,vector<bool>(warehouses,false));
-  int w1, w2;
-  unsigned i2;
+      while (n < static_cast<int>(suppliers.size()) && suppliers[n].second <= best_cost + cost_diff_threshold)
+        n++;
+    }
+  suppliers.resize(n);
+}
+
+CostType FLP_Input::SparseSupplyCost(int s, int w) const
+{ 
+  const int* first = sorted_suppliers.Begin(s);
+  const int* last = sorted_suppliers.End(s);
+  const int* p = lower_bound(first, last, w);
+  if (p != last && *p == w)
+    return sorted_costs.At(s, p - first);
+  const unsigned char* f = fallback_cost[s].data() + static_cast<size_t>(w)*fallback_width[s];
+  unsigned short c16;
+  CostType c;
+  if (fallback_width[s] == 1)
+    return *f;
+  else if (fallback_width[s] == 2)
+    {
+      memcpy(&c16, f, sizeof(c16));
+      return c16;
+    }
+  memcpy(&c, f, sizeof(c));
+  return c;
+}
+
+void FLP_Input::SetFallbackCosts(int s, const vector<CostType>& row)
+{ // the row is stored in the narrowest unsigned width that fits all its costs
+  int w;
+  unsigned short c16;
+  unsigned char width = 1;
+  for (w = 0; w < warehouses; w++)
+    if (row[w] < 0 || row[w] > 65535)
+      {
+        width = sizeof(CostType);
+        break;
+      }
+    else if (row[w] > 255)
+      width = 2;
+  vector<unsigned char>& r = fallback_cost[s];
+  r.assign(static_cast<size_t>(warehouses)*width, 0);
+  r.shrink_to_fit();
+  fallback_width[s] = width;
+  for (w = 0; w < warehouses; w++)
+    if (width == 1)
+      r[w] = row[w];
+    else if (width == 2)
+      {
+        c16 = row[w];
+        memcpy(r.data() + 2*static_cast<size_t>(w), &c16, sizeof(c16));
+      }
+    else
+      memcpy(r.data() + static_cast<size_t>(w)*width, &row[w], sizeof(CostType));
+}
+
+void FLP_Input::ComputePreferredClients()
+{ // the preferred clients of each warehouse are ordered by cost, and among the ones with
+  // the same cost by decreasing index
+  int s, w, i;
+  vector<int> list_size(warehouses,0);
   for (s = 0; s < stores; s++)
-    for (i = 0; static_cast<unsigned>(i) < preferred_suppliers[s].size()-1; i++)
+    for (i = 0; i < PreferredSuppliers(s); i++)
+      list_size[PreferredSupplier(s,i)]++;
+  preferred_clients.Allocate(list_size);
+  fill(list_size.begin(), list_size.end(), 0);
+  for (s = stores - 1; s >= 0; s--)
+    for (i = 0; i < PreferredSuppliers(s); i++)
       {
-        w1 = preferred_suppliers[s][i];
-        for (i2 = i+1; i2 < preferred_suppliers[s].size(); i2++)
-          {
-            w2 = preferred_suppliers[s][i2];            
-            if (w1 < w2)
-              {
-                if (!neighbors[w1][w2])
-                  {
-                    neighbor_warehouses.push_back(make_pair(w1,w2));
-                    neighbors[w1][w2] = true;
-                  }
-              }
-            else if (w2 < w1)
-              {
-                if (!neighbors[w2][w1])
-                  {
-                    neighbor_warehouses.push_back(make_pair(w2,w1));
-                    neighbors[w2][w1] = true;
-                  }
-              }
-          } 
+        w = PreferredSupplier(s,i);
+        preferred_clients.At(w,list_size[w]++) = s;
       }
+  for (w = 0; w < warehouses; w++)
+    stable_sort(preferred_clients.Begin(w), preferred_clients.End(w), 
+                [this, w](int s1, int s2) { return SupplyCost(s1,w) < SupplyCost(s2,w); });
 }
 
-void FLP_Input::InsertClient(int w, int s)
-{ // insert client s in the preferred_clients of w (ordered by cost)
-  unsigned i = 0;
-  while (i < preferred_clients[w].size() && supply_cost[s][w] > supply_cost[preferred_clients[w][i]][w])
-    i++;
-  preferred_clients[w].insert(preferred_clients[w].begin() + i, s);
+void FLP_Input::ComputeNeighborWarehouses()
+{ // two warehouses are neighbors if they are both preferred by at least one store;
+  // the pairs (w1,w2), with w1 < w2, are ordered lexicographically
+  int w1, w2, s, i, j;
+  vector<int> marked(warehouses,-1); // last w1 that has been paired with each warehouse
+  neighbor_warehouses = FlatLists<int>();
+  for (w1 = 0; w1 < warehouses; w1++)
+    {
+      neighbor_warehouses.NewList();
+      for (i = 0; i < PreferredClients(w1); i++)
+        {
+          s = PreferredClient(w1,i);
+          for (j = 0; j < PreferredSuppliers(s); j++)
+            {
+              w2 = PreferredSupplier(s,j);
+              if (w2 > w1 && marked[w2] != w1)
+                {
+                  marked[w2] = w1;
+                  neighbor_warehouses.Add(w2);
+                }
+            }
+        }
+      sort(neighbor_warehouses.Begin(w1), neighbor_warehouses.End(w1));
+    }
 }
 
-ostream& operator<<(ostream& os, const FLP_Input& in)
+void FLP_Input::ComputeRenumbering()
+{ // reverse Cuthill-McKee order of the graph whose nodes are the stores and the warehouses, and 
+  // whose edges are the preferences and the incompatibilities: each connected component is visited
+  // in breadth-first order, starting from a node of minimum degree and enqueueing the neighbors 
+  // by increasing degree; stores and warehouses are then numbered in reverse order of visit
+  // (node v is store v if v < stores, and warehouse v - stores otherwise)
+  int v, u, i, k, n = stores + warehouses;
+  unsigned head;
+  vector<int> queue, neighbors, by_degree(n), degree(n);
+  vector<bool> visited(n, false);
+  
+  for (v = 0; v < n; v++)
+    {
+      by_degree[v] = v;
+      degree[v] = v < stores ? PreferredSuppliers(v) + StoreIncompatibilities(v) : PreferredClients(v - stores);
+    }
+  stable_sort(by_degree.begin(), by_degree.end(), [&degree](int v1, int v2) { return degree[v1] < degree[v2]; });
+  queue.reserve(n);
+  k = 0; 
+  while (static_cast<int>(queue.size()) < n)
+    {
+      while (visited[by_degree[k]])
+        k++;
+      head = queue.size();
+      visited[by_degree[k]] = true;
+      queue.push_back(by_degree[k]);
+      while (head < queue.size())
+        {
+          v = queue[head++];
+          neighbors.clear();
+          if (v < stores)
+            {
+              for (i = 0; i < PreferredSuppliers(v); i++)
+                neighbors.push_back(stores + PreferredSupplier(v,i));
+              for (i = 0; i < StoreIncompatibilities(v); i++)
+                neighbors.push_back(StoreIncompatibility(v,i));
+            }
+          else
+            for (i = 0; i < PreferredClients(v - stores); i++)
+              neighbors.push_back(PreferredClient(v - stores,i));
+          stable_sort(neighbors.begin(), neighbors.end(), [&degree](int v1, int v2) { return degree[v1] < degree[v2]; });
+          for (i = 0; i < static_cast<int>(neighbors.size()); i++)
+            {
+              u = neighbors[i];
+              if (!visited[u])
+                {
+                  visited[u] = true;
+                  queue.push_back(u);
+                }
+            }
+        }
+    }
+  original_store.clear();
+  original_warehouse.clear();
+  for (i = n - 1; i >= 0; i--)
+    if (queue[i] < stores)
+      original_store.push_back(queue[i]);
+    else
+      original_warehouse.push_back(queue[i] - stores);
+}
+
+template <typename T>
+static void Permute(vector<T>& v, const vector<int>& original)
+{ // element i becomes the old element original[i]
+  vector<T> old(v);
+  for (unsigned i = 0; i < v.size(); i++)
+    v[i] = old[original[i]];
+}
+
+void FLP_Input::Renumber()
+{ // move all the data read from the file to the internal ids (the inverse maps are not set yet)
+  int s, w, i, os;
+  vector<int> new_store(stores), new_warehouse(warehouses);
+  vector<CostType> row;
+  vector<pair<int,CostType>> suppliers;
+  FlatLists<int> new_suppliers, new_sorted_suppliers, new_incompatibility_list;
+  FlatLists<CostType> new_costs, new_sorted_costs;
+  
+  for (s = 0; s < stores; s++)
+    new_store[original_store[s]] = s;
+  for (w = 0; w < warehouses; w++)
+    new_warehouse[original_warehouse[w]] = w;
+  
+  Permute(capacity, original_warehouse);
+  Permute(fixed_cost, original_warehouse);
+  Permute(amount_of_goods, original_store);
+  if (sparse_costs)
+    { // the rows are moved, and their columns permuted with a copy of one row at a time
+      vector<vector<unsigned char>> old_costs;
+      vector<unsigned char> old_row;
+      int width;
+      old_costs.swap(fallback_cost);
+      fallback_cost.resize(stores);
+      Permute(fallback_width, original_store);
+      for (s = 0; s < stores; s++)
+        {
+          fallback_cost[s] = move(old_costs[original_store[s]]);
+          old_row = fallback_cost[s];
+          width = fallback_width[s];
+          for (w = 0; w < warehouses; w++)
+            memcpy(fallback_cost[s].data() + static_cast<size_t>(w)*width, 
+                   old_row.data() + static_cast<size_t>(original_warehouse[w])*width, width);
+        }
+    }
+  else
+    {
+      Permute(supply_cost, original_store);
+      for (s = 0; s < stores; s++)
+        {
+          row = supply_cost[s];
+          for (w = 0; w < warehouses; w++)
+            supply_cost[s][w] = row[original_warehouse[w]];
+        }
+    }
+  
+  for (i = 0; i < static_cast<int>(incompatibilities.size()); i++)
+    {
+      incompatibilities[i].first = new_store[incompatibilities[i].first];
+      incompatibilities[i].second = new_store[incompatibilities[i].second];
+    }
+  for (s = 0; s < stores; s++)
+    {
+      os = original_store[s];
+      new_incompatibility_list.NewList();
+      for (i = 0; i < incompatibility_list.Size(os); i++)
+        new_incompatibility_list.Add(new_store[incompatibility_list.At(os,i)]);
+      sort(new_incompatibility_list.Begin(s), new_incompatibility_list.End(s));
+
+      // preferred suppliers keep their order, the slot index is sorted again
+      suppliers.clear();
+      new_suppliers.NewList();
+      new_costs.NewList();
+      for (i = 0; i < preferred_suppliers.Size(os); i++)
+        {
+          w = new_warehouse[preferred_suppliers.At(os,i)];
+          new_suppliers.Add(w);
+          new_costs.Add(preferred_costs.At(os,i));
+          suppliers.push_back(make_pair(w,preferred_costs.At(os,i)));
+        }
+      sort(suppliers.begin(), suppliers.end());
+      new_sorted_suppliers.NewList();
+      if (sparse_costs)
+        new_sorted_costs.NewList();
+      for (i = 0; i < static_cast<int>(suppliers.size()); i++)
+        {
+          new_sorted_suppliers.Add(suppliers[i].first);
+          if (sparse_costs)
+            new_sorted_costs.Add(suppliers[i].second);
+        }
+    }
+  incompatibility_list = move(new_incompatibility_list);
+  preferred_suppliers = move(new_suppliers);
+  preferred_costs = move(new_costs);
+  sorted_suppliers = move(new_sorted_suppliers);
+  sorted_costs = move(new_sorted_costs);
+}
+
+unsigned long long FLP_Input::Fingerprint() const
 {
-  int w, s, i;
+  int s, w, i;
+  unsigned long long h = 14695981039346656037ULL;
+  auto add = [&h](long long x)
+    {
+      for (int k = 0; k < 8; k++, x >>= 8)
+        {
+          h ^= static_cast<unsigned char>(x);
+          h *= 1099511628211ULL;
+        }
+    };
+  add(stores);
+  add(warehouses);
+  for (w = 0; w < warehouses; w++)
+    {
+      add(capacity[InternalWarehouse(w)]);
+      add(fixed_cost[InternalWarehouse(w)]);
+    }
+  for (s = 0; s < stores; s++)
+    add(amount_of_goods[InternalStore(s)]);
+  for (s = 0; s < stores; s++)
+    for (w = 0; w < warehouses; w++)
+      add(SupplyCost(InternalStore(s),InternalWarehouse(w)));
+  add(incompatibilities.size());
+  for (i = 0; i < static_cast<int>(incompatibilities.size()); i++)
+    {
+      add(OriginalStore(incompatibilities[i].first));
+      add(OriginalStore(incompatibilities[i].second));
+    }
+  return h;
+}
+
+double PeakResidentMemory()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0; // ru_maxrss is in KB
+}
+
+ostream& operator<<(ostream& os, const FLP_Input& in)
+{ // the instance is printed with the ids of the input file
+  int w, s, i, is;
   os << "Warehouses = " << in.warehouses << ";" << endl;
   os << "Stores = " << in.stores << ";" << endl;
   os << endl;
@@ -156,7 +713,7 @@ ostream& operator<<(ostream& os, const FLP_Input& in)
   os << "Capacity = [";
   for (w = 0; w < in.warehouses; w++)
     {
-      os << in.capacity[w];
+      os << in.capacity[in.InternalWarehouse(w)];
       if (w < in.warehouses - 1)
         os << ", ";
       else
@@ -166,7 +723,7 @@ ostream& operator<<(ostream& os, const FLP_Input& in)
   os << "FixedCost = [";
   for (w = 0; w < in.warehouses; w++)
     {
-      os << in.fixed_cost[w];
+      os << in.fixed_cost[in.InternalWarehouse(w)];
       if (w < in.warehouses - 1)
         os << ", ";
       else
@@ -176,7 +733,7 @@ ostream& operator<<(ostream& os, const FLP_Input& in)
   os << "Goods = [";
   for (s = 0; s < in.stores; s++)
     {
-      os << in.amount_of_goods[s];
+      os << in.amount_of_goods[in.InternalStore(s)];
       if (s < in.stores - 1)
         os << ", ";
       else
@@ -188,7 +745,7 @@ ostream& operator<<(ostream& os, const FLP_Input& in)
     {
       for (w = 0; w < in.warehouses; w++)
         {
-          os << in.supply_cost[s][w];
+          os << in.SupplyCost(in.InternalStore(s),in.InternalWarehouse(w));
           if (w < in.warehouses - 1)
             os << ",";
           else
@@ -200,17 +757,19 @@ ostream& operator<<(ostream& os, const FLP_Input& in)
   os << "Incompatibilities = " << in.incompatibilities.size() << ";" << endl;
   os << "IncompatiblePairs = [|";
   for (i = 0; i < static_cast<int>(in.incompatibilities.size()); i++)
-    os << " " << in.incompatibilities[i].first+1 << ", " << in.incompatibilities[i].second+1 << " |";
+    os << " " << in.OriginalStore(in.incompatibilities[i].first)+1 << ", " 
+       << in.OriginalStore(in.incompatibilities[i].second)+1 << " |";
   os << "];" << endl;
   
   os << "Preferred suppliers:" << endl;
   for (s = 0; s < in.stores; s++)
     {
       os << s << ": ";
-      for (i = 0; i < static_cast<int>(in.preferred_suppliers[s].size()); i++)
+      is = in.InternalStore(s);
+      for (i = 0; i < in.PreferredSuppliers(is); i++)
         {
-          w = in.preferred_suppliers[s][i];
-          os << w << '/' << in.supply_cost[s][w] << " ";
+          w = in.PreferredSupplier(is,i);
+          os << in.OriginalWarehouse(w) << '/' << in.SupplyCost(is,w) << " ";
         }
       os << endl;
     }
@@ -218,10 +777,10 @@ ostream& operator<<(ostream& os, const FLP_Input& in)
   for (w = 0; w < in.warehouses; w++)
     {
       os << w << ": ";
-      for (i = 0; i < static_cast<int>(in.preferred_clients[w].size()); i++)
+      for (i = 0; i < in.PreferredClients(in.InternalWarehouse(w)); i++)
         {
-          s = in.preferred_clients[w][i];
-          os << s << '/' << in.supply_cost[s][w] << " ";
+          s = in.PreferredClient(in.InternalWarehouse(w),i);
+          os << in.OriginalStore(s) << '/' << in.SupplyCost(s,in.InternalWarehouse(w)) << " ";
         }
       os << endl;
     }
@@ -233,17 +792,13 @@ ostream& operator<<(ostream& os, const FLP_Input& in)
 void FLP_Input:: PrintStatistics(ostream& os) const
 {
   int s, w;
-  float total_demand = 0, total_capacity = 0, avg_opening_cost = 0, avg_supply_cost = 0;
+  float total_demand = 0, total_capacity = 0, avg_opening_cost = 0, avg_supply_cost = total_supply_cost;
 
   cerr << "warehouses; stores; number of incompatibilities; average opening cost; average supply cost; ratio between the total demand and the total capacity;" << endl;
   
   for (w = 0; w < warehouses; w++)
     avg_opening_cost += fixed_cost[w];
 
-  for (s = 0; s < stores; s++)
-    for (w = 0; w < warehouses; w++)
-      avg_supply_cost += supply_cost[s][w];
-
   for (s = 0; s < stores; s++)
     total_demand += amount_of_goods[s];
 
@@ -4,7 +4,9 @@
 #include <iostream>
 #include <cstdlib>
 #include <vector>
+#include <map>
 #include <algorithm>
+#include <functional>
 
 using namespace std;
 typedef int CostType;
@@ -18,42 +20,172 @@ inline bool Member(const vector<int>& v, int e)
 inline bool Member(const vector<pair<int,int> >& v, pair<int,int> e)
 { return find(v.begin(), v.end(), e) != v.end(); }
 
+double PeakResidentMemory(); // peak resident set size of the process (in MB)
+
+template <typename T>
+class FlatLists
+{ // a list of lists stored in CSR form: list i is data[start[i]], ..., data[start[i+1]-1]
+public:
+  FlatLists() : start(1,0) {}
+  int Lists() const { return start.size() - 1; }
+  int Elements() const { return data.size(); }
+  int Size(int i) const { return start[i+1] - start[i]; }
+  int First(int i) const { return start[i]; } // position of the first element of list i
+  int ListOf(int k) const { return upper_bound(start.begin(), start.end(), static_cast<unsigned>(k)) - start.begin() - 1; } // list of the k-th element
+  const T& operator[](int k) const { return data[k]; }
+  const T& At(int i, int j) const { return data[start[i] + j]; }
+  T& At(int i, int j) { return data[start[i] + j]; }
+  const T* Begin(int i) const { return data.data() + start[i]; }
+  const T* End(int i) const { return data.data() + start[i+1]; }
+  T* Begin(int i) { return data.data() + start[i]; }
+  T* End(int i) { return data.data() + start[i+1]; }
+  void NewList() { start.push_back(start.back()); } // lists built in order: open a new (last) list
+  void Add(const T& e) { data.push_back(e); start.back()++; } // append e to the last list
+  void Replace(const map<int,vector<T>>& lists) // each list i in lists becomes lists[i], in a single pass over the data
+  {
+    if (lists.empty())
+      return;
+    vector<unsigned> new_start(start.size(), 0);
+    vector<T> new_data;
+    auto next = lists.begin();
+    new_data.reserve(data.size());
+    for (int i = 0; i < Lists(); i++)
+      {
+        new_start[i] = new_data.size();
+        if (next != lists.end() && next->first == i)
+          {
+            new_data.insert(new_data.end(), next->second.begin(), next->second.end());
+            ++next;
+          }
+        else
+          new_data.insert(new_data.end(), data.begin() + start[i], data.begin() + start[i+1]);
+      }
+    new_start.back() = new_data.size();
+    start.swap(new_start);
+    data.swap(new_data);
+  }
+  void Allocate(const vector<int>& sizes) // lists built by position: allocate all of them
+  {
+    start.assign(sizes.size() + 1, 0);
+    for (unsigned i = 0; i < sizes.size(); i++)
+      start[i+1] = start[i] + sizes[i];
+    data.assign(start.back(), T());
+  }
+private:
+  vector<unsigned> start;
+  vector<T> data;
+};
+
 class FLP_Input 
 {
   friend ostream& operator<<(ostream& os, const FLP_Input& in);
 public:
-  FLP_Input(string file_name, double sqrt_ratio_preferred, int cost_diff_threshold);
+  FLP_Input(string file_name, double sqrt_ratio_preferred, int cost_diff_threshold, bool sparse_costs = false,
+            bool renumber = false); // throws invalid_argument if the file cannot be opened or is not valid
   int Stores() const { return stores; }
   int Warehouses() const { return warehouses; }
   int Capacity(int w) const { return capacity[w]; }
   int FixedCost(int w) const { return fixed_cost[w]; }
   int AmountOfGoods(int s) const { return amount_of_goods[s]; }
-  CostType SupplyCost(int s, int w) const { return supply_cost[s][w]; }
+  CostType SupplyCost(int s, int w) const { return sparse_costs ? SparseSupplyCost(s,w) : supply_cost[s][w]; }
+  bool SparseCosts() const { return sparse_costs; }
   int Incompatibilities() const { return incompatibilities.size(); }
   pair<int, int> Incompatibility(int i) const { return incompatibilities[i]; }
-  int StoreIncompatibilities(int s) const { return incompatibility_list[s].size(); }
-  int StoreIncompatibility(int s, int i) const { return incompatibility_list[s][i]; }
-  bool Incompatible(int s1, int s2) const { return Member(incompatibility_list[s1],s2); }
-  int PreferredSuppliers(int s) const { return preferred_suppliers[s].size(); }
-  int PreferredSupplier(int s, int i) const { return preferred_suppliers[s][i]; }
-  int PreferredClients(int w) const { return preferred_clients[w].size(); }
-  int PreferredClient(int w, int i) const { return preferred_clients[w][i]; }
-  bool Preference(int s, int w) const { return preference[s][w]; }
-  int NeighborWarehousePairs() const { return neighbor_warehouses.size(); }
-  pair<int,int> NeighborWarehouses(int i) const { return neighbor_warehouses[i]; }
+  int StoreIncompatibilities(int s) const { return incompatibility_list.Size(s); }
+  int StoreIncompatibility(int s, int i) const { return incompatibility_list.At(s,i); }
+  bool Incompatible(int s1, int s2) const 
+  { return binary_search(incompatibility_list.Begin(s1), incompatibility_list.End(s1), s2); }
+  int PreferredSuppliers(int s) const { return preferred_suppliers.Size(s); }
+  int PreferredSupplier(int s, int i) const { return preferred_suppliers.At(s,i); }
+  CostType PreferredSupplierCost(int s, int i) const { return preferred_costs.At(s,i); } // SupplyCost(s,PreferredSupplier(s,i))
+  int PreferredClients(int w) const { return preferred_clients.Size(w); }
+  int PreferredClient(int w, int i) const { return preferred_clients.At(w,i); }
+  bool Preference(int s, int w) const 
+  { return binary_search(sorted_suppliers.Begin(s), sorted_suppliers.End(s), w); }
+  int PreferredPairs() const { return preferred_suppliers.Elements(); }
+  int PreferredPairStore(int k) const { return preferred_suppliers.ListOf(k); } // store of the k-th preferred pair (O(log S))
+  int FirstPreferredPair(int s) const { return preferred_suppliers.First(s); }
+  int NeighborWarehousePairs() const { return neighbor_warehouses.Elements(); }
+  pair<int,int> NeighborWarehouses(int i) const { return make_pair(neighbor_warehouses.ListOf(i), neighbor_warehouses[i]); }
   void PrintStatistics(ostream& os) const;
+  // reduction: the preferred pairs (s,w) such that pruned(s,w) are removed (but the first of each store), and 
+  // the warehouses in fixed_open must be open in all solutions that are worth exploring; this is a hint, not a
+  // constraint: only the Clopen moves never close them, the other moves and the constructions may leave them
+  // empty (in states that cost more than the known solution)
+  void Reduce(function<bool(int,int)> pruned, const vector<bool>& fixed_open);
+  bool FixedOpen(int w) const { return fixed_open[w]; }
+  // FNV-1a hash of the data (sizes, capacities, fixed costs, demands, supply costs, and incompatible pairs) in
+  // the ids of the file, so it does not depend on the preprocessing: O(S x W)
+  unsigned long long Fingerprint() const;
+  double SqrtRatioPreferred() const { return sqrt_ratio; } // the parameters of the preferred suppliers
+  int CostDiffThreshold() const { return cost_diff_threshold; }
+  // deltas: the data is changed in place, and the derived data (preferred suppliers and clients, neighbor
+  // warehouses) is recomputed only for the stores and warehouses reached by the change (the preferred suppliers
+  // of a store are recomputed from its costs, so a previous reduction is not kept for it); the lists are
+  // stored contiguously, so each change costs a pass over them, unless the changes are made between
+  // BeginChanges and EndChanges, which patches all of them in a single pass (the queries see the old derived
+  // data until then); the solutions must then be repaired (FLP_SolutionManager::RepairState), and the
+  // explorers and solvers built again; invalid values throw invalid_argument, as in the file
+  void BeginChanges() { batch = true; }
+  void EndChanges() { batch = false; ApplyChanges(); }
+  void SetAmountOfGoods(int s, int q); // at least 2
+  void SetCapacity(int w, int c); // at least 0
+  void SetFixedCost(int w, int c);
+  void SetSupplyCosts(int s, const vector<CostType>& row); // row: cost of each warehouse
+  void AddIncompatibility(int s1, int s2);
+  void RemoveIncompatibility(int s1, int s2);
+  void CloseWarehouse(int w); // capacity 0, and removed from all the preferred lists (for good)
+  bool Available(int w) const { return !closed[w]; }
+  // stores and warehouses are possibly renumbered internally (the maps are the identity otherwise): 
+  // all the methods use internal ids, the original ones are used only for input and output
+  bool Renumbered() const { return renumbered; }
+  int OriginalStore(int s) const { return original_store[s]; }
+  int OriginalWarehouse(int w) const { return original_warehouse[w]; }
+  int InternalStore(int s) const { return internal_store[s]; }
+  int InternalWarehouse(int w) const { return internal_warehouse[w]; }
  private:
   int stores, warehouses;
   vector<int> capacity;
   vector<int> fixed_cost;
   vector<int> amount_of_goods;
+  bool sparse_costs; // if set, supply_cost is not stored: preferred pairs are in sorted_costs, the others in the fallback
   vector<vector<CostType>> supply_cost;
+  // the fallback is still dense (all the warehouses of each store), only narrower than supply_cost: the row of
+  // each store is kept in the narrowest width that fits its costs (1, 2, or sizeof(CostType) bytes each), so
+  // that a change of width copies one row only
+  vector<vector<unsigned char>> fallback_cost;
+  vector<unsigned char> fallback_width;
+  double total_supply_cost;
   vector<pair<int,int>> incompatibilities; // list of incompatible pairs of stores
-  vector<vector<int>> incompatibility_list;
-  vector<vector<int>> preferred_suppliers; // list of preferred suppliers for each store
-  vector<vector<int>> preferred_clients; // list of preferred clients for each warehouse
-  vector<vector<bool>> preference; // store X warehouse matrix of preferred suppliers
-  vector<pair<int,int>> neighbor_warehouses; // store the pairs of "neighbor" warehouses (i.e. with at least one client in common)
-  void InsertClient(int w, int s);
+  FlatLists<int> incompatibility_list; // for each store, the sorted list of the incompatible ones
+  FlatLists<int> preferred_suppliers; // list of preferred suppliers for each store (ordered by cost)
+  FlatLists<CostType> preferred_costs; // their supply costs
+  FlatLists<int> sorted_suppliers; // the same lists, ordered by index (slot index for the preference and cost queries)
+  FlatLists<CostType> sorted_costs; // their supply costs (sparse mode only)
+  FlatLists<int> preferred_clients; // list of preferred clients for each warehouse (ordered by cost)
+  FlatLists<int> neighbor_warehouses; // store the pairs of "neighbor" warehouses (i.e. with at least one client in common):
+                                      // list w1 contains the sorted neighbors w2 of w1 such that w1 < w2
+  vector<bool> fixed_open;
+  vector<bool> closed; // by CloseWarehouse
+  double sqrt_ratio;
+  int preferred, cost_diff_threshold; // parameters of the preferred suppliers
+  bool batch; // between BeginChanges and EndChanges
+  map<int,vector<CostType>> changed_rows; // supply costs of the stores whose preferred lists must be recomputed
+  map<int,vector<int>> changed_incompatibilities; // new lists of the stores
+  bool renumbered;
+  vector<int> original_store, original_warehouse; // internal id -> id in the input file
+  vector<int> internal_store, internal_warehouse; // id in the input file -> internal id
+  void ComputePreferredSuppliers(int s, const vector<CostType>& row, vector<pair<int,CostType>>& suppliers);
+  void SelectPreferredSuppliers(const vector<CostType>& row, vector<pair<int,CostType>>& suppliers) const;
+  void ApplyChanges();
+  vector<int>& ChangedIncompatibilities(int s); // the list of s, copied at its first change
+  bool ChangedIncompatible(int s1, int s2);
+  void ComputePreferredClients();
+  void NeighborWarehouses(int w1, vector<int>& neighbors) const; // list w1 of neighbor_warehouses
+  CostType SparseSupplyCost(int s, int w) const;
+  void SetFallbackCosts(int s, const vector<CostType>& row);
+  void ComputeNeighborWarehouses();
+  void ComputeRenumbering();
+  void Renumber();
 };
 #endif
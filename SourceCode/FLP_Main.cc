@@ -1,7 +1,10 @@
+#include <fstream>
+#include <iomanip>
+#include "FLP_Solver.hh"
+#include "FLP_Checkpoint.hh"
+#include "FLP_Server.hh"
 #include "FLP_Helpers.hh"
 
-using namespace EasyLocal::Debug;
-
 int main(int argc, const char* argv[])
 {
   ParameterBox main_parameters("main", "Main Program options");
@@ -9,7 +12,12 @@ int main(int argc, const char* argv[])
   Parameter<unsigned> seed("seed", "Random seed", main_parameters);
   Parameter<string> method("method", "Solution method (empty for tester)", main_parameters);   
   Parameter<string> init_state("init_state", "Initial state (to be read from file)", main_parameters);
+  Parameter<string> checkpoint_file("checkpoint_file", "Save checkpoints of the annealing run to this file", main_parameters);
+  Parameter<double> checkpoint_interval("checkpoint_interval", "Minimum interval in seconds between two checkpoints", main_parameters);
+  Parameter<string> resume("resume", "Continue the annealing run saved in this checkpoint file", main_parameters);
+  Parameter<double> warm_temperature_ratio("warm_temperature_ratio", "Ratio of the start temperatures of SA and LNS when starting from init_state", main_parameters);
   Parameter<string> output_file("output_file", "Write the output to a file (filename required)", main_parameters);
+  Parameter<string> output_format("output_format", "Format of the output file (text or binary)", main_parameters);
   Parameter<double> swap_rate("swap_rate", "Swap rate", main_parameters);
   Parameter<double> swap_bias("swap_bias", "Swap bias toward second supplier", main_parameters);
   Parameter<double> close_rate("close_irate", "Close internal rate", main_parameters);
@@ -17,6 +25,23 @@ int main(int argc, const char* argv[])
   Parameter<double> clopen_rate("clopen_rate", "Clopen rate", main_parameters);
   Parameter<string> init_state_strategy("init_state_strategy", "Initial state strategy (random or greedy)", main_parameters);
   Parameter<int> timeout_factor("timeout_factor", "Timeout factor for sqrt ration (default = 10)", main_parameters);
+  Parameter<bool> filtered_sampling("filtered_sampling", "Draw Change/Swap moves only among feasible candidates", main_parameters);
+  Parameter<double> gap_threshold("gap_threshold", "Stop when the gap from the Lagrangian bound is below this ratio", main_parameters);
+  Parameter<double> timeout("timeout", "Stop the search after this many seconds from the initial state (0 = no limit)", main_parameters);
+  Parameter<bool> reduce("reduce", "Reduce the instance by Lagrangian bounds before the search", main_parameters);
+  Parameter<int> reduction_cost("reduction_cost", "Cost of a known solution used by the reduction (default greedy)", main_parameters);
+  Parameter<bool> polish("polish", "Re-optimize the supply of the final solution by min-cost flow", main_parameters);
+  Parameter<unsigned long> polish_interval("polish_interval", "Re-optimize the supply of the current state every this many iterations (0 = never)", main_parameters);
+  Parameter<bool> clopen_cache("clopen_cache", "Reuse the Clopen transfer plans while the warehouses they read are unchanged", main_parameters);
+  Parameter<unsigned> threads("threads", "Number of threads of the parallel methods (0 = hardware threads)", main_parameters);
+  Parameter<int> starts("starts", "Number of randomized initial constructions, run in parallel", main_parameters);
+  Parameter<unsigned> keep_starts("keep_starts", "Best initial states kept: the solver runs from each of them", main_parameters);
+  Parameter<double> random_starts("random_starts", "Rate of the initial constructions made by RandomState (greedy otherwise)", main_parameters);
+  Parameter<double> init_time_limit("init_time_limit", "The initial constructions (but the first) are stopped after this many seconds (0 = no limit)", main_parameters);
+  Parameter<bool> fused_delta("fused_delta", "Evaluate moves with a single fused supply/opening delta cost", main_parameters);
+  Parameter<string> serve("serve", "Serve JSON requests on a Unix domain socket (- = stdin/stdout)", main_parameters);
+  Parameter<unsigned> workers("workers", "Number of requests served concurrently (0 = hardware threads)", main_parameters);
+  Parameter<unsigned> cache_size("cache_size", "Number of instances kept in memory by the server", main_parameters);
 
   swap_rate = 0.19;
   swap_bias = 0.44;
@@ -25,177 +50,305 @@ int main(int argc, const char* argv[])
   clopen_rate = 0.1;
   init_state_strategy = "greedy";
   timeout_factor = 10;
+  output_format = "text";
+  filtered_sampling = false;
+  fused_delta = false;
+  reduce = false;
+  polish = false;
+  clopen_cache = false;
+  threads = 0;
+  starts = 1;
+  keep_starts = 1;
+  random_starts = 0.0;
+  init_time_limit = 0.0;
+  timeout = 0.0;
+  warm_temperature_ratio = 0.1;
+  checkpoint_interval = 60.0;
+  polish_interval = 0;
+  workers = 0;
+  cache_size = 8;
 
   Parameter<string> timeout_mode("timeout_mode", "Timeout mode", main_parameters);
   timeout_mode = "sqrt";
   
+  ParameterBox lns_parameters("LNS", "Large neighborhood search options");
+  Parameter<unsigned long> lns_iterations("iterations", "Number of destroy and repair iterations", lns_parameters);
+  Parameter<int> lns_max_removed("max_removed", "Stores removed by a destroy (at least)", lns_parameters);
+  Parameter<double> lns_start_temperature("start_temperature", "Starting temperature", lns_parameters);
+  Parameter<double> lns_min_temperature("min_temperature", "Final temperature", lns_parameters);
+
+  lns_iterations = 100000;
+  lns_max_removed = 30;
+  lns_start_temperature = 100.0;
+  lns_min_temperature = 1.0;
+
+  ParameterBox ils_parameters("ILS", "Iterated local search options");
+  Parameter<unsigned long> ils_iterations("iterations", "Number of kicks", ils_parameters);
+  Parameter<int> ils_kick_length("kick_length", "Clopen moves of a kick", ils_parameters);
+  Parameter<double> ils_threshold("threshold", "Accept the states whose cost exceeds the best one by at most this ratio", ils_parameters);
+
+  ils_iterations = 10000;
+  ils_kick_length = 1;
+  ils_threshold = 0.0;
+
+  ParameterBox hts_parameters("HTS", "Hashed tabu search options");
+  Parameter<unsigned long> hts_iterations("iterations", "Number of iterations", hts_parameters);
+  Parameter<int> hts_samples("samples", "Moves sampled at each iteration", hts_parameters);
+  Parameter<unsigned long> hts_tenure("tenure", "Iterations a visited state stays tabu", hts_parameters);
+  Parameter<unsigned> hts_elite("elite", "Size of the pool of the best local minima", hts_parameters);
+  Parameter<unsigned long> hts_restart("restart", "Restart from an elite state after this many iterations without improvement (0 = never)", hts_parameters);
+
+  hts_iterations = 100000;
+  hts_samples = 100;
+  hts_tenure = 1000;
+  hts_elite = 10;
+  hts_restart = 5000;
+
   ParameterBox input_parameters("input", "Input Program options");
   Parameter<double> sqrt_ratio_preferred("sqrt_ratio_preferred", "Square root ratio of preferred warehouses for store", input_parameters);
   Parameter<int> cost_diff_threshold("diff_threshold", "Threshold of the difference w.r.t. the minimum cost", input_parameters);
+  Parameter<bool> sparse_costs("sparse_costs", "Store the supply costs of the preferred suppliers only", input_parameters);
+  Parameter<bool> renumber("renumber", "Renumber stores and warehouses to improve locality", input_parameters);
 
   sqrt_ratio_preferred = 1.0;
   cost_diff_threshold = 100;
+  sparse_costs = false;
+  renumber = false;
 
   // 3rd parameter: false = do not check unregistered parameters, 4th parameter: true = silent
   CommandLineParameters::Parse(argc, argv, false, true);  
 
+  if (serve.IsSet())
+    { // the instances and the options come with the requests
+      if (!CommandLineParameters::Parse(argc, argv, true, false))
+        return 1;
+      FLP_Server server(workers, cache_size);
+      try
+        {
+          server.Serve(serve);
+        }
+      catch (const runtime_error& e)
+        {
+          cerr << e.what() << endl;
+          return 1;
+        }
+      return 0;
+    }
   if (!instance.IsSet())
     {
       cout << "Error: --main::instance filename option must always be set" << endl;
       return 1;
     }
-  FLP_Input in(instance,  sqrt_ratio_preferred, cost_diff_threshold);
-
-  FLP_Output init(in);  
+  if (output_format != string("text") && output_format != string("binary"))
+    {
+      cout << "Error: --main::output_format must be text or binary" << endl;
+      return 1;
+    }
+  unique_ptr<FLP_Input> input;
+  try
+    {
+      input.reset(new FLP_Input(instance,  sqrt_ratio_preferred, cost_diff_threshold, sparse_costs, renumber));
+    }
+  catch (const invalid_argument& e)
+    {
+      cerr << e.what() << endl;
+      return 1;
+    }
+  const FLP_Input& in = *input;
+  double input_memory = PeakResidentMemory();
 
+  FLP_Options options;
+  if (method.IsSet())
+    options.method = method;
+  options.random_seed = !seed.IsSet();
   if (seed.IsSet())
-    Random::SetSeed(seed);
-
-  FLP_Supply cc1(in, 1, false);
-  FLP_Opening cc2(in, 1, false);
- 
-  FLP_ChangeDeltaSupply dc_cc1(in, cc1);
-  FLP_ChangeDeltaOpening dc_cc2(in, cc2);
+    options.seed = seed;
+  options.init_state_strategy = init_state_strategy;
+  options.swap_rate = swap_rate;
+  options.swap_bias = swap_bias;
+  options.close_rate = close_rate;
+  options.open_rate = open_rate;
+  options.clopen_rate = clopen_rate;
+  options.timeout_mode = timeout_mode;
+  options.timeout_factor = timeout_factor;
+  options.filtered_sampling = filtered_sampling;
+  options.fused_delta = fused_delta;
+  options.clopen_cache = clopen_cache;
+  if (gap_threshold.IsSet())
+    options.gap_threshold = gap_threshold;
+  options.timeout = timeout;
+  options.reduce = reduce;
+  if (reduction_cost.IsSet())
+    options.reduction_cost = reduction_cost;
+  options.polish = polish;
+  options.polish_interval = polish_interval;
+  options.threads = threads;
+  options.starts = starts;
+  options.keep_starts = keep_starts;
+  options.random_starts = random_starts;
+  options.init_time_limit = init_time_limit;
+  options.warm_temperature_ratio = warm_temperature_ratio;
+  if (checkpoint_file.IsSet())
+    options.checkpoint_file = checkpoint_file;
+  options.checkpoint_interval = checkpoint_interval;
+  options.lns_iterations = lns_iterations;
+  options.lns_max_removed = lns_max_removed;
+  options.lns_start_temperature = lns_start_temperature;
+  options.lns_min_temperature = lns_min_temperature;
+  options.ils_iterations = ils_iterations;
+  options.ils_kick_length = ils_kick_length;
+  options.ils_threshold = ils_threshold;
+  options.hts_iterations = hts_iterations;
+  options.hts_samples = hts_samples;
+  options.hts_tenure = hts_tenure;
+  options.hts_elite = hts_elite;
+  options.hts_restart = hts_restart;
 
-  FLP_SwapDeltaSupply ds_cc1(in, cc1);
-  // FLP_SwapDeltaOpening ds_cc2(in, cc2);
-
-  FLP_ClopenDeltaSupply dk_cc1(in, cc1);
-  FLP_ClopenDeltaOpening dk_cc2(in, cc2);
+  FLP_Checkpoint checkpoint;
+  if (resume.IsSet())
+    { // the reduction must use the same known cost as the saved run (the greedy one depends on the seed)
+      try
+        {
+          checkpoint = ReadCheckpoint(resume);
+        }
+      catch (const invalid_argument& e)
+        {
+          cerr << "Cannot resume: " << e.what() << endl;
+          return 1;
+        }
+      if (options.reduce && !reduction_cost.IsSet())
+        options.reduction_cost = checkpoint.reduction_cost;
+    }
 
-  // helpers
-  FLP_SolutionManager sm(in);
-  FLP_ChangeNeighborhoodExplorer cnhe(in, sm);
-  FLP_SwapNeighborhoodExplorer snhe(in, sm, swap_bias);
-  FLP_ClopenNeighborhoodExplorer knhe(in, sm, close_rate, open_rate);
-  
-  // All cost components must be added to the state manager
-  sm.AddCostComponent(cc1);
-  sm.AddCostComponent(cc2);
-  
-  // All delta cost components must be added to the neighborhood explorer
-  cnhe.AddDeltaCostComponent(dc_cc1);
-  cnhe.AddDeltaCostComponent(dc_cc2);
-
-  snhe.AddDeltaCostComponent(ds_cc1);
-  // snhe.AddDeltaCostComponent(ds_cc2);
-
-  knhe.AddDeltaCostComponent(dk_cc1);
-  knhe.AddDeltaCostComponent(dk_cc2);
-
- // neighborhood compositions
-  SetUnionNeighborhoodExplorer<FLP_Input, FLP_Output, DefaultCostStructure<CostType>, FLP_ChangeNeighborhoodExplorer, FLP_SwapNeighborhoodExplorer> csnhe(in, sm, "Change/Swap",  cnhe, snhe, {1 - swap_rate, swap_rate});
-  SetUnionNeighborhoodExplorer<FLP_Input, FLP_Output, DefaultCostStructure<CostType>, FLP_ChangeNeighborhoodExplorer, FLP_SwapNeighborhoodExplorer, FLP_ClopenNeighborhoodExplorer> csknhe(in, sm, "Change/Swap/Clopen",  cnhe, snhe, knhe, {1 - swap_rate - clopen_rate, swap_rate, clopen_rate});
-
-  // runners
-  HillClimbing<FLP_Input, FLP_Output, FLP_Change, DefaultCostStructure<CostType>> chc(in, sm, cnhe, "CHC");
-  SteepestDescent<FLP_Input, FLP_Output, FLP_Change, DefaultCostStructure<CostType>> csd(in, sm, cnhe, "CSD");
-  SteepestDescent<FLP_Input, FLP_Output, decltype(csnhe)::MoveType, DefaultCostStructure<CostType>> cssd(in, sm, csnhe, "CSSD");
-  SimulatedAnnealing<FLP_Input, FLP_Output, FLP_Change, DefaultCostStructure<CostType>> csa(in, sm, cnhe, "CSA");
-  TabuSearch<FLP_Input, FLP_Output, FLP_Change, DefaultCostStructure<CostType>> cts(in, sm, cnhe, "CTS", FLP_Change::Inverse);
-  SimulatedAnnealing<FLP_Input, FLP_Output, decltype(csnhe)::MoveType, DefaultCostStructure<CostType>> cssa(in, sm, csnhe, "CSSA");
-  SimulatedAnnealing<FLP_Input, FLP_Output, decltype(csknhe)::MoveType, DefaultCostStructure<CostType>> csksa(in, sm, csknhe, "CSKSA");
-  TabuSearch<FLP_Input, FLP_Output, decltype(csknhe)::MoveType, DefaultCostStructure<CostType>> cskts(in, sm, csknhe, "CSKTS");
-  SimulatedAnnealingTimeBased<FLP_Input, FLP_Output, decltype(csknhe)::MoveType, DefaultCostStructure<CostType>> csksa_tb(in, sm, csknhe, "CSKSAtb");
-
-  // tester
-  Tester<FLP_Input, FLP_Output, DefaultCostStructure<CostType>> tester(in, sm);
-  MoveTester<FLP_Input, FLP_Output, FLP_Change, DefaultCostStructure<CostType>> change_move_test(in, sm, cnhe, "FLP_Change move", tester);
-  MoveTester<FLP_Input, FLP_Output, FLP_Swap, DefaultCostStructure<CostType>> swap_move_test(in, sm, snhe, "FLP_Swap move", tester);
-  MoveTester<FLP_Input, FLP_Output, FLP_Clopen, DefaultCostStructure<CostType>> k_move_test(in, sm, knhe, "FLP_Clopen move", tester);
-  MoveTester<FLP_Input, FLP_Output, decltype(csnhe)::MoveType, DefaultCostStructure<CostType>> cs_move_test(in, sm, csnhe, "Change/Swap move", tester); 
-  MoveTester<FLP_Input, FLP_Output, decltype(csknhe)::MoveType, DefaultCostStructure<CostType>> csk_move_test(in, sm, csknhe, "Change/Swap/Clopen move", tester); 
-
-  SimpleLocalSearch<FLP_Input, FLP_Output, DefaultCostStructure<CostType>> solver(in, sm, "FLP solver");
-  if (!CommandLineParameters::Parse(argc, argv, true, false))
+  FLP_Solver solver(in, options);
+  // the parameters of the runners are registered by the solver: the command line is now fully checked
+  if (!solver.ParseArguments(argc, argv))
     return 1;
 
   if (!method.IsSet())
     { // If no search method is set -> enter in the tester
-      if (init_state.IsSet())
-        tester.RunMainMenu(init_state);
-      else
-        tester.RunMainMenu();
-    }
-  else
-    {
-      if (method == string("CSA"))
-        {
-          solver.SetRunner(csa);
-        }
-      else if (method == string("CSSA"))
-        {
-          solver.SetRunner(cssa);
-        }
-      else if (method == string("CSKSAtb"))
+      try
         {
-         solver.SetRunner(csksa_tb);
+          if (init_state.IsSet())
+            solver.RunTester(init_state);
+          else
+            solver.RunTester();
         }
-       else if (method == string("CSKSA"))
+      catch (const FLP_ConstructionError& e)
         {
-          solver.SetRunner(csksa);
+          cout << "{\"greedy\": \"" << e.Reason() << "\", " << e.Details() << "}" << endl;
         }
-       else if (method == string("CHC"))
-        {
-          solver.SetRunner(chc);
+    }
+  else
+    {
+      FLP_Result result(in);
+      if (resume.IsSet())
+        { // the checkpoint is rebuilt and the run continues from it
+          try
+            {
+              result = solver.Resume(checkpoint);
+            }
+          catch (const invalid_argument& e)
+            {
+              cerr << "Cannot resume: " << e.what() << endl;
+              return 1;
+            }
         }
-      else if (method == string("CSD"))
-        {
-          solver.SetRunner(csd);
+      else if (init_state.IsSet())
+        { // the previous solution is repaired and the search starts from it
+          ifstream is(static_cast<string>(init_state).c_str());
+          if (!is)
+            {
+              cerr << "Cannot open the initial state file " << static_cast<string>(init_state) << endl;
+              return 1;
+            }
+          try
+            {
+              result = solver.WarmStart(is);
+            }
+          catch (const invalid_argument& e)
+            {
+              cerr << "Cannot read the initial state: " << e.what() << endl;
+              return 1;
+            }
         }
       else
-        {
-          cerr << "Unknown method " << static_cast<string>(method) << endl;
+        result = solver.Solve();
+      if (result.error != "")
+        { // as the construction of the run reports it, with no solution
+          cout << "{\"greedy\": \"" << result.error << "\", " << result.error_details << "}" << endl;
+          return 0;
         }
-      chrono::time_point<chrono::system_clock> start = chrono::system_clock::now(), end;
-      if(init_state_strategy == "greedy")
-	sm.GreedyState(init);
-      else if(init_state_strategy == "random")
-	sm.RandomState(init);
-      else
-	throw invalid_argument("Unknown initial state strategy");
-	
-      end = chrono::system_clock::now();
-      double time1 = chrono::duration_cast<chrono::milliseconds>(end-start).count()/1000.0;
-
-      if (method == string("CSKSAtb"))
-        {
-          if (timeout_mode == "linear")
-            csksa_tb.SetParameter("allowed_running_time", in.Warehouses() - time1);
-          else
-            csksa_tb.SetParameter("allowed_running_time", timeout_factor*sqrt(in.Warehouses()) - time1);
+      if (output_file.IsSet() && output_format == string("binary"))
+        { // the solution only, for another run (--main::init_state)
+          ofstream os(static_cast<string>(output_file).c_str(), ios::binary);
+          result.output.WriteBinary(os);
         }
-
-      auto result = solver.Resolve(init);
-      // result is a tuple: 0: solution, 1: number of violations, 2: total cost, 3: computing time
-    
-      FLP_Output out = result.output;
-      if (output_file.IsSet())
+      else if (output_file.IsSet())
         { // write the output on the file passed in the command line
           ofstream os(static_cast<string>(output_file).c_str());
-          out.PrettyPrint(os);
+          result.output.PrettyPrint(os);
           os << endl;
-          os << "Cost: " << result.cost.total << endl;
-          os << "Time: " << result.running_time + time1 << "s"; 
+          os << "Cost: " << result.cost << endl;
+          os << "Time: " << result.time + result.init_time << "s"; 
           os.close();
         }
       else
         { 
           cout << "{" << setprecision(10)
-               << "\"cost\": " <<  result.cost.total <<  ", "
-               << "\"supply\": " << cc1.ComputeCost(out) << ", "
-               << "\"opening\": " << cc2.ComputeCost(out) << ", "
-               << "\"init_cost\": " <<  init.ComputeCost() <<  ", "
-               << "\"init_supply\": " << cc1.ComputeCost(init) << ", "
-               << "\"init_opening\": " << cc2.ComputeCost(init) << ", "
-               << "\"init_time\": " << time1 << ", "
-               << "\"time\": " << result.running_time << ", "            
-               << "\"consistent\": \"" << (sm.CheckConsistency(out) ? "yes" : "no") << "\"" << ", "
-               << "\"ss_ratio\": " << static_cast<double>(out.NumberOfSigleSourceStores())/in.Stores() << ", "
-               << "\"open_ratio\": " << static_cast<double>(out.NumberOfOpenWarehouses())/in.Warehouses() << ", ";
+               << "\"cost\": " <<  result.cost <<  ", "
+               << "\"supply\": " << result.supply << ", "
+               << "\"opening\": " << result.opening << ", "
+               << "\"init_cost\": " <<  result.init_cost <<  ", "
+               << "\"init_supply\": " << result.init_supply << ", "
+               << "\"init_opening\": " << result.init_opening << ", "
+               << "\"init_time\": " << result.init_time << ", "
+               << "\"time\": " << result.time << ", "            
+               << "\"consistent\": \"" << (result.consistent ? "yes" : "no") << "\"" << ", "
+               << "\"ss_ratio\": " << static_cast<double>(result.output.NumberOfSigleSourceStores())/in.Stores() << ", "
+               << "\"open_ratio\": " << static_cast<double>(result.output.NumberOfOpenWarehouses())/in.Warehouses() << ", ";
             if (method == string("CSKSAtb"))
-              cout << "\"iterations\": " << csksa_tb.Evaluations() <<  ", ";
-            cout << "\"seed\": " << Random::GetSeed() << "} " << endl;
+              cout << "\"iterations\": " << result.iterations <<  ", ";
+            if (method == string("KPSD") || method == string("CPSD") || method == string("LNS") || method == string("ILS"))
+              cout << "\"moves\": " << result.moves <<  ", ";
+            if (method == string("CPSD"))
+              cout << "\"sweeps\": " << result.sweeps <<  ", ";
+            if (method == string("HTS"))
+              cout << "\"tabu_hits\": " << result.tabu_hits <<  ", "
+                   << "\"elite_size\": " << result.elite_size <<  ", "
+                   << "\"elite_duplicates\": " << result.elite_duplicates <<  ", "
+                   << "\"restarts\": " << result.restarts <<  ", ";
+            cout << "\"change_wasted_draws\": " << result.change_wasted_draws << ", "
+                 << "\"swap_wasted_draws\": " << result.swap_wasted_draws << ", ";
+            if (gap_threshold.IsSet())
+              cout << "\"lower_bound\": " << result.lower_bound << ", "
+                   << "\"gap\": " << static_cast<double>(result.cost - result.lower_bound)/result.cost << ", ";
+            if (reduce)
+              cout << "\"reduction_time\": " << result.reduction_time << ", "
+                   << "\"fixed_warehouses\": " << result.fixed_warehouses << ", "
+                   << "\"excluded_warehouses\": " << result.excluded_warehouses << ", "
+                   << "\"removed_preferred_pairs\": " << result.removed_preferred_pairs << ", "
+                   << "\"removed_neighbor_pairs\": " << result.removed_neighbor_pairs << ", ";
+            if (clopen_cache)
+              cout << "\"clopen_cache_lookups\": " << result.clopen_cache_lookups << ", "
+                   << "\"clopen_cache_hit_rate\": " << result.clopen_cache_hit_rate << ", ";
+            if (polish || polish_interval > 0)
+              cout << "\"polish_calls\": " << result.polish_calls << ", "
+                   << "\"polish_improvements\": " << result.polish_improvements << ", "
+                   << "\"polish_time\": " << result.polish_time << ", ";
+            if (starts > 1)
+              cout << "\"constructions\": " << result.constructions << ", "
+                   << "\"kept_starts\": " << result.kept_starts << ", ";
+            if (checkpoint_file.IsSet())
+              cout << "\"checkpoints\": " << result.checkpoints << ", ";
+            if (init_state.IsSet() && !resume.IsSet())
+              cout << "\"repaired_stores\": " << result.repaired_stores << ", ";
+            if (result.greedy_repairs > 0 || result.greedy_restarts > 0)
+              cout << "\"greedy_repairs\": " << result.greedy_repairs << ", "
+                   << "\"greedy_restarts\": " << result.greedy_restarts << ", ";
+            cout << "\"input_memory\": " << input_memory << ", "
+                 << "\"peak_memory\": " << PeakResidentMemory() << ", ";
+            cout << "\"seed\": " << result.seed << "} " << endl;
         }
    }
   return 0;
@@ -3,45 +3,121 @@
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <atomic>
+#include <charconv>
+#include <cctype>
+#include <cstring>
 #include "FLP_Output.hh"
 
 FLP_Output::FLP_Output(const FLP_Input& my_in)
-  : in(my_in), assignment(in.Stores()), load(in.Warehouses(),0), 
-    incompatible(in.Stores(),vector<int>(in.Warehouses())), 
-    client_list(in.Warehouses())
+  : in(my_in), assignment(in.Stores()), load(in.Warehouses(),0), residual(in.Warehouses()),
+    incompatible(in.Stores(),vector<CounterType>(in.Warehouses())), 
+    client_list(in.Warehouses()), identity(NewIdentity()), version(0), hash(0), last_modified(in.Warehouses(),0),
+    journaling(false)
+{
+  int w;
+  CheckLayout();
+  for (w = 0; w < in.Warehouses(); w++)
+    residual[w] = in.Capacity(w);
+}
+
+void FLP_Output::CheckLayout() const
+{
+#ifdef FLP_COMPACT_LAYOUT
+  int s, w, max_capacity = 0, max_demand = 0, max_incompatibilities = 0;
+  for (w = 0; w < in.Warehouses(); w++)
+    max_capacity = max(max_capacity, in.Capacity(w));
+  for (s = 0; s < in.Stores(); s++)
+    {
+      max_demand = max(max_demand, in.AmountOfGoods(s));
+      max_incompatibilities = max(max_incompatibilities, in.StoreIncompatibilities(s));
+    }
+  if (in.Warehouses() > INT16_MAX || max_capacity > INT16_MAX || max_demand > INT16_MAX 
+      || max_incompatibilities > UINT16_MAX)
+    throw invalid_argument("Instance too large for the compact layout (compile without FLP_COMPACT_LAYOUT)");
+#endif
+}
+
+void FLP_Output::CheckQuantity(int w, int q) const
+{
+#ifdef FLP_COMPACT_LAYOUT
+  long long new_load = static_cast<long long>(load[w]) + q, new_residual = static_cast<long long>(residual[w]) - q;
+  if (q < INT16_MIN || q > INT16_MAX || new_load < INT16_MIN || new_load > INT16_MAX 
+      || new_residual < INT16_MIN || new_residual > INT16_MAX)
+    throw invalid_argument("Quantity " + to_string(q) + " out of the compact layout for warehouse " 
+                           + to_string(in.OriginalWarehouse(w)) + " (compile without FLP_COMPACT_LAYOUT)");
+#endif
+}
+
+FLP_Output::FLP_Output(const FLP_Output& out)
+  : in(out.in), assignment(out.assignment), load(out.load), residual(out.residual),
+    incompatible(out.incompatible), client_list(out.client_list), 
+    identity(NewIdentity()), version(0), hash(out.hash), last_modified(in.Warehouses(),0), journaling(false)
 {}
 
 FLP_Output& FLP_Output::operator=(const FLP_Output& out)
 {
   assignment = out.assignment;
   load = out.load;
+  residual = out.residual;
   incompatible = out.incompatible;
   client_list = out.client_list;
+  identity = NewIdentity(); // the copy evolves independently from out
+  version = 0;
+  hash = out.hash;
+  fill(last_modified.begin(), last_modified.end(), 0);
+  journal.clear();
+  journaling = false;
   return *this;
 }
 
+unsigned long long FLP_Output::NewIdentity()
+{
+  static atomic<unsigned long long> last_identity(0);
+  return ++last_identity;
+}
+
+unsigned long long FLP_Output::Key(int s, int w, int q)
+{ // splitmix64 finalizer applied in cascade, so that no table of keys is needed
+  auto mix = [](unsigned long long x)
+    {
+      x += 0x9E3779B97F4A7C15ULL;
+      x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+      return x ^ (x >> 31);
+    };
+  return mix(mix(mix(s) + w) + q);
+}
+
 void FLP_Output::AssignFirst(int s, int w, int q)
 { // assign to w1, starting from empty solution
+  Record(s);
+  ToggleHash(s);
+  version++;
   assignment[s].w1 = w;
   assignment[s].q1 = q;
   client_list[w].push_back(s);
-  load[w] += q;
+  AddLoad(w, q);
   int s2, i;
   for (i = 0; i < in.StoreIncompatibilities(s); i++)
     {
       s2 = in.StoreIncompatibility(s,i);
       incompatible[s2][w]++;
     }
+  ToggleHash(s);
 }
 	
 void FLP_Output::AssignSecond(int s, int w, int q)
 { // assign to w2, starting from empty solution
+  Record(s);
+  ToggleHash(s);
+  version++;
   assignment[s].w2 = w;  
   assignment[s].q2 = q;
   if (w != -1)
   {
     client_list[w].push_back(s);
-    load[w] += q;
+    AddLoad(w, q);
     int s2, i;
     for (i = 0; i < in.StoreIncompatibilities(s); i++)
       {
@@ -50,14 +126,18 @@ void FLP_Output::AssignSecond(int s, int w, int q)
       }
   }
   ReorderSuppliers(s);
+  ToggleHash(s);
 }
 
 void FLP_Output::FullAssign(int s, int w)
 {  // full assign to w1, starting from empty solution
+  Record(s);
+  ToggleHash(s);
+  version++;
   assignment[s].w1 = w;
   assignment[s].q1 = in.AmountOfGoods(s);
   client_list[w].push_back(s);
-  load[w] += in.AmountOfGoods(s);
+  AddLoad(w, in.AmountOfGoods(s));
   int s2, i;
   for (i = 0; i < in.StoreIncompatibilities(s); i++)
     {
@@ -66,6 +146,7 @@ void FLP_Output::FullAssign(int s, int w)
     }
   assignment[s].w2 = -1;
   assignment[s].q2 = 0;
+  ToggleHash(s);
 }
 
 void FLP_Output::ChangeFirstSupplierAndQuantity(int s, int new_w, int new_q)
@@ -74,6 +155,9 @@ void FLP_Output::ChangeFirstSupplierAndQuantity(int s, int new_w, int new_q)
   int old_w1 = assignment[s].w1, old_w2 = assignment[s].w2;
   int old_q1 = assignment[s].q1, old_q2 = assignment[s].q2;
   int new_q2 = in.AmountOfGoods(s) - new_q;	
+  Record(s);
+  ToggleHash(s);
+  version++;
 
   assignment[s].w1 = new_w;
   assignment[s].q1 = new_q;
@@ -82,9 +166,10 @@ void FLP_Output::ChangeFirstSupplierAndQuantity(int s, int new_w, int new_q)
   client_list[new_w].push_back(s);
   RemoveElement(client_list[old_w1],s);
 
-  load[new_w] += new_q;
-  load[old_w1] -= old_q1;
-  load[old_w2] += (new_q2 - old_q2);
+  AddLoad(new_w, new_q);
+  AddLoad(old_w1, -old_q1);
+  if (old_w2 != -1)
+    AddLoad(old_w2, new_q2 - old_q2);
 
   int s2, i;
   for (i = 0; i < in.StoreIncompatibilities(s); i++)
@@ -94,6 +179,7 @@ void FLP_Output::ChangeFirstSupplierAndQuantity(int s, int new_w, int new_q)
      incompatible[s2][old_w1]--;
   }
   ReorderSuppliers(s);
+  ToggleHash(s);
 }
 
 void FLP_Output::ChangeSecondSupplierAndQuantity(int s, int new_w, int new_q)
@@ -103,6 +189,9 @@ void FLP_Output::ChangeSecondSupplierAndQuantity(int s, int new_w, int new_q)
   int old_w1 = assignment[s].w1, old_w2 = assignment[s].w2;
   int old_q1 = assignment[s].q1, old_q2 = assignment[s].q2;
   int new_q1 = in.AmountOfGoods(s) - new_q;	
+  Record(s);
+  ToggleHash(s);
+  version++;
 
   if (new_q == 0) // do not assign to new_w if quantity new_q has been set to 0 by CheckAndComputeRedistribution
     new_w = -1;
@@ -116,9 +205,11 @@ void FLP_Output::ChangeSecondSupplierAndQuantity(int s, int new_w, int new_q)
   if (old_w2 != -1)
     RemoveElement(client_list[old_w2],s);
 
-  load[new_w] += new_q;
-  load[old_w2] -= old_q2;
-  load[old_w1] += (new_q1 - old_q1);
+  if (new_w != -1)
+    AddLoad(new_w, new_q);
+  if (old_w2 != -1)
+    AddLoad(old_w2, -old_q2);
+  AddLoad(old_w1, new_q1 - old_q1);
 
   int s2, i;
   for (i = 0; i < in.StoreIncompatibilities(s); i++)
@@ -128,6 +219,7 @@ void FLP_Output::ChangeSecondSupplierAndQuantity(int s, int new_w, int new_q)
      if (old_w2 != -1) incompatible[s2][old_w2]--;
   }
   ReorderSuppliers(s);
+  ToggleHash(s);
 }
 
 void FLP_Output::ReorderSuppliers(int s)
@@ -143,6 +235,9 @@ void FLP_Output::ReplaceSupplier(int s, Position pos, int new_w, int q)
 { // NOTE: quantity q is passed and not computed, because in the Swap move it might 
   // be changed by the first call to the second one
   int old_w, other_old_w;
+  Record(s);
+  ToggleHash(s);
+  version++;
     
   if (pos == Position::FIRST)
     {
@@ -156,9 +251,9 @@ void FLP_Output::ReplaceSupplier(int s, Position pos, int new_w, int q)
       other_old_w = assignment[s].w1;
       assignment[s].w2 = new_w;		
     }
-  load[new_w] += q;
+  AddLoad(new_w, q);
   RemoveElement(client_list[old_w],s);
-  load[old_w] -= q;
+  AddLoad(old_w, -q);
 
   int i, s2;
   for (i = 0; i < in.StoreIncompatibilities(s); i++)
@@ -180,11 +275,75 @@ void FLP_Output::ReplaceSupplier(int s, Position pos, int new_w, int q)
       assignment[s].q2 = 0;
       assignment[s].w2 = -1;
     }
+  ToggleHash(s);
+}
+
+void FLP_Output::Unassign(int s)
+{
+  int i, s2;
+  Record(s);
+  ToggleHash(s);
+  version++;
+  // each supplier with its own quantity (the two suppliers may coincide in a state not yet repaired)
+  for (const pair<int,int>& supply : {pair<int,int>(assignment[s].w1, assignment[s].q1),
+                                      pair<int,int>(assignment[s].w2, assignment[s].q2)})
+    if (supply.first != -1)
+      {
+        RemoveElement(client_list[supply.first],s);
+        AddLoad(supply.first, -supply.second);
+        for (i = 0; i < in.StoreIncompatibilities(s); i++)
+          {
+            s2 = in.StoreIncompatibility(s,i);
+            incompatible[s2][supply.first]--;
+          }
+      }
+  assignment[s].w1 = -1;
+  assignment[s].w2 = -1;
+  assignment[s].q1 = 0;
+  assignment[s].q2 = 0;
+  ToggleHash(s);
+}
+
+void FLP_Output::AssignRead(int s, int w1, int q1, int w2, int q2)
+{ // internal ids, w2 = -1 for none
+  CheckQuantity(w1, q1);
+  if (w2 != -1)
+    CheckQuantity(w2, q2);
+  if (w2 == w1)
+    {
+      q1 += q2;
+      w2 = -1;
+      q2 = 0;
+      CheckQuantity(w1, q1);
+    }
+  AssignFirst(s, w1, q1);
+  if (w2 != -1)
+    AssignSecond(s, w2, q2);
+}
+
+void FLP_Output::Rollback()
+{ // the previous assignments are restored backwards (the order of the clients of a warehouse may change)
+  int i, s;
+  journaling = false;
+  for (i = journal.size() - 1; i >= 0; i--)
+    {
+      s = journal[i].first;
+      const Suppliers& old = journal[i].second;
+      Unassign(s);
+      if (old.w1 != -1)
+        {
+          AssignFirst(s, old.w1, old.q1);
+          AssignSecond(s, old.w2, old.q2);
+        }
+    }
+  journal.clear();
 }
 
 void FLP_Output::Reset()
 {
   int s, w;
+  version++;
+  hash = 0;
   for (s = 0; s < in.Stores(); s++)
     {
       assignment[s].w1 = -1;
@@ -198,9 +357,28 @@ void FLP_Output::Reset()
     {
       client_list[w].clear();
       load[w] = 0;
+      residual[w] = in.Capacity(w);
+      last_modified[w] = version;
     }
 }
 
+void FLP_Output::Rebuild()
+{ // loads may exceed the capacities, and suppliers are reordered if their costs have changed
+  int s;
+  vector<Suppliers> kept(assignment);
+  CheckLayout(); // the loads are unchanged, the residual capacities fit if the capacities do
+  journal.clear();
+  journaling = false;
+  Reset();
+  for (s = 0; s < in.Stores(); s++)
+    if (kept[s].w1 != -1)
+      {
+        AssignFirst(s, kept[s].w1, kept[s].q1);
+        if (kept[s].w2 != -1)
+          AssignSecond(s, kept[s].w2, kept[s].q2);
+      }
+}
+
 int FLP_Output::CheckAndComputeQuantity(int s, int new_w, Position pos) const
 { 
   // computes the best quantity to assign to new_w to be inserted in position pos
@@ -352,71 +530,248 @@ ostream& operator<<(ostream& os, const Suppliers& sup)
   return os << '(' << sup.w1 << '/' << sup.q1 << ',' <<  sup.w2 << '/' << sup.q2 << ')';
 }
 
+namespace
+{
+  class SolutionWriter
+  { // the text of a solution is composed in a buffer by to_chars, and written at once
+  public:
+    SolutionWriter(size_t size) { buffer.reserve(size); }
+    void Put(char c) { buffer.push_back(c); }
+    void Put(const char* text) { buffer.append(text); }
+    void Put(int n)
+    {
+      char digits[12];
+      buffer.append(digits, to_chars(digits, digits + sizeof(digits), n).ptr - digits);
+    }
+    void Write(ostream& os) const { os.write(buffer.data(), buffer.size()); }
+  private:
+    string buffer;
+  };
+
+  class SolutionReader
+  { // a cursor on the text of a solution, read at once up to its closing bracket; blanks are skipped
+  public:
+    SolutionReader(istream& is, char closing)
+    {
+      if (!getline(is, text, closing))
+        throw invalid_argument("Truncated solution");
+      p = text.data();
+      end = p + text.size();
+    }
+    bool AtEnd() { Skip(); return p == end; }
+    void Expect(char c)
+    {
+      Skip();
+      if (p == end || *p != c)
+        throw invalid_argument(string("Malformed solution: '") + c + "' expected");
+      p++;
+    }
+    int Int()
+    {
+      int n;
+      Skip();
+      from_chars_result r = from_chars(p, end, n);
+      if (r.ec != errc())
+        throw invalid_argument("Malformed solution: number expected");
+      p = r.ptr;
+      return n;
+    }
+  private:
+    void Skip() { while (p != end && isspace(static_cast<unsigned char>(*p))) p++; }
+    string text;
+    const char *p, *end;
+  };
+
+  const char BINARY_MAGIC[8] = {'F','L','P','S','O','L','B','1'};
+
+  uint64_t Checksum(const char* data, size_t size)
+  { // FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+      h = (h ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+    return h;
+  }
+}
+
 ostream& operator<<(ostream& os, const FLP_Output& out)
-{ 
-  int s;
-  os << "[";
+{ // stores and warehouses are written with the ids of the input file
+  int s, w1, w2;
+  SolutionWriter writer(out.in.Stores() * 24);
+  writer.Put('[');
   for (s = 0; s < out.in.Stores(); s++)
     {
-      os << out.assignment[s];
+      const Suppliers& sup = out.assignment[out.in.InternalStore(s)];
+      w1 = sup.w1 == -1 ? -1 : out.in.OriginalWarehouse(sup.w1);
+      w2 = sup.w2 == -1 ? -1 : out.in.OriginalWarehouse(sup.w2);
+      writer.Put('(');
+      writer.Put(w1);
+      writer.Put('/');
+      writer.Put(sup.q1);
+      writer.Put(',');
+      writer.Put(w2);
+      writer.Put('/');
+      writer.Put(sup.q2);
+      writer.Put(')');
       if (s < out.in.Stores() - 1)
-        os << ", ";
+        writer.Put(", ");
     }
-  os << "]";
-
+  writer.Put(']');
+  writer.Write(os);
   return os;
 }
 
 istream& operator>>(istream& is, FLP_Output& out)
-{// reads both formats, relying on the firse character: '[' = two-source, '{' = multi-source
+{// reads all formats, relying on the first character: '[' = two-source, '{' = multi-source, 'F' = binary
+ // (stores and warehouses have the ids of the input file); the ids are checked, and a warehouse listed
+ // twice for a store is merged in a single supply, while the feasibility of the assignments is left to
+ // FLP_SolutionManager::RepairState
   int s, prev_s;
   int w, w1, w2, q, q1, q2, count;
   char ch;
 
-  out.Reset();
   is >> ch;
+  if (ch == BINARY_MAGIC[0])
+  {
+    is.unget();
+    out.ReadBinary(is);
+    return is;
+  }
+  out.Reset();
   if (ch == '[')
   {
+    SolutionReader reader(is, ']');
     for (s = 0; s < out.in.Stores(); s++)
       {
-        is >> ch >> w1 >> ch >> q1 >> ch >> w2 >> ch >> q2 >> ch >> ch;
-        out.AssignFirst(s,w1,q1);
-        out.AssignSecond(s,w2,q2);
+        if (s > 0)
+          reader.Expect(',');
+        reader.Expect('(');
+        w1 = reader.Int();
+        reader.Expect('/');
+        q1 = reader.Int();
+        reader.Expect(',');
+        w2 = reader.Int();
+        reader.Expect('/');
+        q2 = reader.Int();
+        reader.Expect(')');
+        if (w1 < -1 || w1 >= out.in.Warehouses() || w2 < -1 || w2 >= out.in.Warehouses())
+          throw invalid_argument("Malformed solution at store " + to_string(s));
+        if (w1 == -1) // left unassigned
+          continue;
+        out.AssignRead(out.in.InternalStore(s),out.in.InternalWarehouse(w1),q1,w2 == -1 ? -1 : out.in.InternalWarehouse(w2),q2);
       }
-    is >> ch;
+    if (!reader.AtEnd())
+      throw invalid_argument("Malformed solution: more stores than in the instance");
   }
   else if (ch == '{')
   {
+    SolutionReader reader(is, '}');
     count = 1;
     prev_s = -1;
     do
       {
-        is >> ch >> s >> ch >> w >> ch >> q >> ch >> ch;
+        reader.Expect('(');
+        s = reader.Int();
+        reader.Expect(',');
+        w = reader.Int();
+        reader.Expect(',');
+        q = reader.Int();
+        reader.Expect(')');
+        if (s < 1 || s > out.in.Stores() || w < 1 || w > out.in.Warehouses())
+          throw invalid_argument(prev_s == -1 ? string("Malformed solution at its start") : "Malformed solution after store " + to_string(prev_s));
         if (s == prev_s)
           {
             count++;
             if (count == 2)
-              out.AssignSecond(s-1, w-1, q);
+              { // the first supply is assigned again, together with the second one
+                w1 = out.FirstSupplier(out.in.InternalStore(s-1));
+                q1 = out.FirstQuantity(out.in.InternalStore(s-1));
+                out.Unassign(out.in.InternalStore(s-1));
+                out.AssignRead(out.in.InternalStore(s-1), w1, q1, out.in.InternalWarehouse(w-1), q);
+              }
             else
               throw invalid_argument("More than two suppliers for one store");
           }
+        else if (out.FirstSupplier(out.in.InternalStore(s-1)) != -1)
+          throw invalid_argument("Store " + to_string(s) + " listed twice");
         else
           {
             count = 1;
             prev_s = s;
-            out.AssignFirst(s-1, w-1, q);
+            out.AssignRead(out.in.InternalStore(s-1), out.in.InternalWarehouse(w-1), q, -1, 0);
           }
+        if (reader.AtEnd())
+          break;
+        reader.Expect(',');
       }
-    while (ch == ',');
+    while (true);
   }
   else
     throw invalid_argument("Unknown solution format");
   return is;
 }
 
+void FLP_Output::WriteBinary(ostream& os) const
+{ // magic, numbers of stores and of warehouses, the suppliers and quantities of the stores (in the order and
+  // with the ids of the input file, -1 for none), and the checksum of all that
+  int s;
+  const Suppliers* sup;
+  uint32_t sizes[2] = {static_cast<uint32_t>(in.Stores()), static_cast<uint32_t>(in.Warehouses())};
+  int32_t fields[4];
+  string data;
+  data.reserve(sizeof(BINARY_MAGIC) + sizeof(sizes) + in.Stores() * sizeof(fields) + sizeof(uint64_t));
+  data.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  data.append(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+  for (s = 0; s < in.Stores(); s++)
+    {
+      sup = &assignment[in.InternalStore(s)];
+      fields[0] = sup->w1 == -1 ? -1 : in.OriginalWarehouse(sup->w1);
+      fields[1] = sup->q1;
+      fields[2] = sup->w2 == -1 ? -1 : in.OriginalWarehouse(sup->w2);
+      fields[3] = sup->q2;
+      data.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+    }
+  uint64_t checksum = Checksum(data.data(), data.size());
+  data.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+  os.write(data.data(), data.size());
+}
+
+void FLP_Output::ReadBinary(istream& is)
+{
+  int s;
+  uint32_t sizes[2];
+  int32_t fields[4];
+  uint64_t checksum;
+  string data(sizeof(BINARY_MAGIC) + sizeof(sizes), '\0');
+  if (!is.read(&data[0], data.size()) || !equal(BINARY_MAGIC, BINARY_MAGIC + sizeof(BINARY_MAGIC), data.begin()))
+    throw invalid_argument("Not a binary solution");
+  memcpy(sizes, data.data() + sizeof(BINARY_MAGIC), sizeof(sizes));
+  if (sizes[0] != static_cast<uint32_t>(in.Stores()) || sizes[1] != static_cast<uint32_t>(in.Warehouses()))
+    throw invalid_argument("The solution is for an instance with " + to_string(sizes[0]) + " stores and "
+                           + to_string(sizes[1]) + " warehouses");
+  data.resize(data.size() + in.Stores() * sizeof(fields));
+  if (!is.read(&data[sizeof(BINARY_MAGIC) + sizeof(sizes)], in.Stores() * sizeof(fields))
+      || !is.read(reinterpret_cast<char*>(&checksum), sizeof(checksum)))
+    throw invalid_argument("Truncated solution");
+  if (checksum != Checksum(data.data(), data.size()))
+    throw invalid_argument("Corrupted solution (wrong checksum)");
+  Reset();
+  for (s = 0; s < in.Stores(); s++)
+    {
+      memcpy(fields, data.data() + sizeof(BINARY_MAGIC) + sizeof(sizes) + s * sizeof(fields), sizeof(fields));
+      if (fields[0] < -1 || fields[0] >= in.Warehouses() || fields[2] < -1 || fields[2] >= in.Warehouses())
+        throw invalid_argument("Malformed solution at store " + to_string(s));
+      if (fields[0] == -1)
+        continue;
+      AssignRead(in.InternalStore(s), in.InternalWarehouse(fields[0]), fields[1],
+                 fields[2] == -1 ? -1 : in.InternalWarehouse(fields[2]), fields[3]);
+    }
+}
+
 bool operator==(const FLP_Output& out1, const FLP_Output& out2)
 {
   int s;
+  if (out1.hash != out2.hash)
+    return false;
   for (s = 0; s < out1.in.Stores(); s++)
     if (out1.assignment[s].w1 != out2.assignment[s].w1
      || out1.assignment[s].q1 != out2.assignment[s].q1
@@ -476,18 +831,34 @@ void FLP_Output::Dump(ostream& os) const
 }
 
 void FLP_Output::PrettyPrint(ostream& os) const
-{
-  int s, w;
-  os << "{";
+{ // stores and warehouses are written with the ids of the input file
+  int s;
+  SolutionWriter writer(in.Stores() * 24);
+  writer.Put('{');
   for (s = 0; s < in.Stores(); s++)
     {
-	   w = assignment[s].w1;
-       os << "(" << s+1 << ", " << w+1 << ", " << assignment[s].q1 << ")";
-	   w = assignment[s].w2;	   
-       if (w != -1) 
-		 os << ",(" << s+1 << ", " << w+1 << ", " << assignment[s].q2 << ")";
-       if (s < in.Stores() - 1) os << ", ";
-    } 
-  os << "}";
+      const Suppliers& sup = assignment[in.InternalStore(s)];
+      writer.Put('(');
+      writer.Put(s+1);
+      writer.Put(", ");
+      writer.Put((sup.w1 == -1 ? -1 : in.OriginalWarehouse(sup.w1))+1); // 0 if s is not assigned
+      writer.Put(", ");
+      writer.Put(sup.q1);
+      writer.Put(')');
+      if (sup.w2 != -1)
+        {
+          writer.Put(",(");
+          writer.Put(s+1);
+          writer.Put(", ");
+          writer.Put(in.OriginalWarehouse(sup.w2)+1);
+          writer.Put(", ");
+          writer.Put(sup.q2);
+          writer.Put(')');
+        }
+      if (s < in.Stores() - 1)
+        writer.Put(", ");
+    }
+  writer.Put('}');
+  writer.Write(os);
 }
 
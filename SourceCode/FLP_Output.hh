@@ -5,11 +5,24 @@
 #include <cstdlib>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
 #include "FLP_Input.hh"
 
 using namespace std;
 
-struct Suppliers { int w1 = -1, w2 = -1, q1 = 0, q2 = 0; };
+// widths of the solution data, selected at compile time (-DFLP_COMPACT_LAYOUT packs an
+// assignment in 8 bytes: warehouse ids, capacities, demands and incompatibility counts must fit in 16 bits)
+#ifdef FLP_COMPACT_LAYOUT
+typedef int16_t IndexType;      // warehouse ids
+typedef int16_t QuantityType;   // quantities, loads and residual capacities
+typedef uint16_t CounterType;   // incompatibility counters
+#else
+typedef int IndexType;
+typedef int QuantityType;
+typedef int CounterType;
+#endif
+
+struct Suppliers { IndexType w1 = -1, w2 = -1; QuantityType q1 = 0, q2 = 0; };
 ostream& operator<<(ostream& os, const Suppliers& sup);
 
 enum class Position { FIRST, SECOND };
@@ -30,6 +43,7 @@ class FLP_Output
   friend bool operator==(const FLP_Output& out1, const FLP_Output& out2);
 public:
   FLP_Output(const FLP_Input& i);
+  FLP_Output(const FLP_Output& out);
   FLP_Output& operator=(const FLP_Output& out);
   Suppliers Assignment(int s) const { return assignment[s]; }
   int FirstSupplier(int s) const { return assignment[s].w1; }
@@ -39,6 +53,9 @@ public:
   void FullAssign(int s, int w);
   void AssignFirst(int s, int w, int q);
   void AssignSecond(int s, int w, int q);
+  // throws invalid_argument if q, or the load or the residual capacity of w after adding q, does not fit
+  // QuantityType (the states read are not bound by the capacities); nothing to check without FLP_COMPACT_LAYOUT
+  void CheckQuantity(int w, int q) const;
   void ChangeFirstSupplierAndQuantity(int s, int new_w, int new_q);
   void ChangeSecondSupplierAndQuantity(int s, int new_w, int new_q);
   int CheckAndComputeQuantity(int s, int new_w, Position pos) const; 
@@ -47,28 +64,69 @@ public:
 
 
   void ReplaceSupplier(int s, Position pos, int w, int q);
+  void Unassign(int s); // remove s from its suppliers (s is left without suppliers)
+  // journal: the assignments changed after StartJournal can be restored by Rollback (in time proportional 
+  // to the number of changes) or kept by Commit; Reset must not be called in between
+  void StartJournal() { journal.clear(); journaling = true; }
+  void Rollback();
+  void Commit() { journal.clear(); journaling = false; }
+  int JournalEntries() const { return journal.size(); }
+  int JournalStore(int i) const { return journal[i].first; } // the stores changed since StartJournal (with repetitions)
   int Load(int w) const { return load[w]; }
   bool Open(int w) const { return load[w] > 0; }
   bool Closed(int w) const { return load[w] == 0; }
-  int ResidualCapacity(int w) const { return in.Capacity(w) - load[w]; }
+  int ResidualCapacity(int w) const { return residual[w]; }
   void Reset();
+  void Rebuild(); // the assignments are kept, the rest is recomputed (after a delta of the instance)
   void Dump(ostream& os) const;
   void PrettyPrint(ostream& os) const;
+  // compact binary form, with the ids of the input file and a checksum, also read by operator>>; only the
+  // numbers of stores and warehouses of the instance are stored, so the solution of an earlier version of
+  // the instance (before deltas) is read as well, and made feasible by FLP_SolutionManager::RepairState
+  void WriteBinary(ostream& os) const;
+  void ReadBinary(istream& is); // throws invalid_argument if the data are truncated, corrupted, or of other sizes
   bool Compatible(int s, int w) const { return incompatible[s][w] == 0; } 
   bool AlmostCompatible(int s, int w) const { return incompatible[s][w] == 1; } 
   int Clients(int w) const { return client_list[w].size(); }
   int Client(int w, int i) const { return client_list[w][i]; }
+  // the clients of w are put in the given order, a permutation of them (the Clopen moves visit the clients in order)
+  void SetClientOrder(int w, const vector<int>& clients) { client_list[w] = clients; }
 
   CostType ComputeCost() const;
   int ComputeViolations() const;
   int NumberOfSigleSourceStores() const;
   int NumberOfOpenWarehouses() const;
+  // the pair (identity, version) changes at each modification, and it is never shared by two different contents
+  unsigned long long Identity() const { return identity; }
+  unsigned long long Version() const { return version; }
+  // version of the last modification of the load (and thus of the clients) of warehouse w
+  unsigned long long LastModified(int w) const { return last_modified[w]; }
+  // Zobrist hash of the content: the xor of a pseudo-random key of each (store, supplier, quantity), kept
+  // up to date by the modifiers; equal contents have the same hash, whatever their history
+  unsigned long long Hash() const { return hash; }
+  // what is xor-ed to the hash if the assignment of s becomes sup (the order of the suppliers is irrelevant)
+  unsigned long long HashChange(int s, const Suppliers& sup) const { return AssignmentKey(s,assignment[s]) ^ AssignmentKey(s,sup); }
 private:
   const FLP_Input& in;
   vector<Suppliers> assignment;   // warehouses assigned to the store 
-  vector<int> load; // load assigned to the warehouse
-  vector<vector<int>> incompatible;  // store x warehouse: no. of stores incompatible with s assigned to w
+  vector<QuantityType> load; // load assigned to the warehouse
+  vector<QuantityType> residual; // residual capacity of the warehouse (kept alongside load)
+  vector<vector<CounterType>> incompatible;  // store x warehouse: no. of stores incompatible with s assigned to w
   vector<vector<int>> client_list; // list of stores supplied by a warehouse
+  unsigned long long identity, version; 
+  unsigned long long hash;
+  vector<unsigned long long> last_modified; // of each warehouse
+  bool journaling;
+  vector<pair<int,Suppliers>> journal; // previous assignments of the stores changed
+  void Record(int s) { if (journaling) journal.push_back(make_pair(s, assignment[s])); }
   void ReorderSuppliers(int s);
+  void CheckLayout() const; // the instance fits the widths of the solution data
+  void AssignRead(int s, int w1, int q1, int w2, int q2); // a supplier listed twice gets the sum of its quantities
+  static unsigned long long Key(int s, int w, int q);
+  unsigned long long AssignmentKey(int s, const Suppliers& sup) const 
+  { return (sup.w1 == -1 ? 0 : Key(s,sup.w1,sup.q1)) ^ (sup.w2 == -1 ? 0 : Key(s,sup.w2,sup.q2)); }
+  void ToggleHash(int s) { hash ^= AssignmentKey(s,assignment[s]); } // called before and after each change of s
+  void AddLoad(int w, int q) { load[w] += q; residual[w] -= q; last_modified[w] = version; }
+  static unsigned long long NewIdentity();
 };
 #endif
@@ -0,0 +1,278 @@
+// File FLP_Parallel.cc
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <chrono>
+#include <memory>
+#include "FLP_Parallel.hh"
+
+FLP_ThreadPool::FLP_ThreadPool(unsigned threads)
+  : task(nullptr), generation(0), running(0), quit(false)
+{
+  unsigned t;
+  if (threads == 0)
+    threads = max(1u, thread::hardware_concurrency());
+  for (t = 1; t < threads; t++)
+    workers.push_back(thread(&FLP_ThreadPool::Work, this, t));
+}
+
+FLP_ThreadPool::~FLP_ThreadPool()
+{
+  {
+    lock_guard<mutex> lock(m);
+    quit = true;
+  }
+  start.notify_all();
+  for (thread& w : workers)
+    w.join();
+}
+
+void FLP_ThreadPool::Run(const function<void(unsigned)>& t)
+{
+  {
+    lock_guard<mutex> lock(m);
+    task = &t;
+    running = workers.size();
+    generation++;
+  }
+  start.notify_all();
+  t(0);
+  unique_lock<mutex> lock(m);
+  done.wait(lock, [this] { return running == 0; });
+  task = nullptr;
+}
+
+void FLP_ThreadPool::Work(unsigned t)
+{
+  unsigned long long seen = 0;
+  const function<void(unsigned)>* current;
+  while (true)
+    {
+      {
+        unique_lock<mutex> lock(m);
+        start.wait(lock, [this, seen] { return quit || generation != seen; });
+        if (quit)
+          return;
+        seen = generation;
+        current = task;
+      }
+      (*current)(t);
+      {
+        lock_guard<mutex> lock(m);
+        running--;
+      }
+      done.notify_one();
+    }
+}
+
+void FLP_ThreadPool::ParallelFor(int n, int chunk, const function<void(unsigned,int,int)>& body)
+{
+  atomic<int> next(0);
+  Run([&](unsigned t)
+      {
+        int begin;
+        while ((begin = next.fetch_add(chunk)) < n)
+          body(t, begin, min(begin + chunk, n));
+      });
+}
+
+FLP_ParallelClopenSearch::FLP_ParallelClopenSearch(const FLP_Input& my_in, const FLP_ClopenNeighborhoodExplorer& my_ne, FLP_ThreadPool& my_pool)
+  : in(my_in), ne(my_ne), pool(my_pool), moves(pool.Size()), best(pool.Size()), thread_evaluations(pool.Size()), evaluations(0)
+{}
+
+bool FLP_ParallelClopenSearch::SelectBest(const FLP_Output& st, FLP_Clopen& mv, CostType& delta)
+{
+  const pair<CostType,int> NONE(numeric_limits<CostType>::max(), numeric_limits<int>::max());
+  unsigned t;
+  pair<CostType,int> overall = NONE;
+
+  fill(best.begin(), best.end(), NONE);
+  fill(thread_evaluations.begin(), thread_evaluations.end(), 0);
+  pool.ParallelFor(ne.Moves(), CHUNK, [this, &st](unsigned t, int begin, int end)
+                   {
+                     int k;
+                     CostType d;
+                     for (k = begin; k < end; k++)
+                       if (ne.MoveAt(st, k, moves[t]))
+                         {
+                           d = ne.DeltaCostFunctionComponents(st, moves[t]).total;
+                           thread_evaluations[t]++;
+                           if (make_pair(d, k) < best[t])
+                             best[t] = make_pair(d, k);
+                         }
+                   });
+  for (t = 0; t < pool.Size(); t++)
+    {
+      evaluations += thread_evaluations[t];
+      overall = min(overall, best[t]);
+    }
+  if (overall == NONE)
+    return false;
+  ne.MoveAt(st, overall.second, mv); // recompute the plan of the selected move
+  delta = overall.first;
+  return true;
+}
+
+unsigned long FLP_ParallelClopenSearch::Descend(FLP_Output& st)
+{
+  unsigned long iterations = 0;
+  FLP_Clopen mv;
+  CostType delta;
+  while (SelectBest(st, mv, delta) && delta < 0)
+    {
+      ne.MakeMove(st, mv);
+      iterations++;
+    }
+  return iterations;
+}
+
+FLP_ParallelChangeSearch::FLP_ParallelChangeSearch(const FLP_Input& my_in, const FLP_ChangeNeighborhoodExplorer& my_ne, FLP_ThreadPool& my_pool)
+  : in(my_in), ne(my_ne), pool(my_pool), best_moves(in.Stores()), best_delta(in.Stores()), 
+    thread_evaluations(pool.Size()), touched(in.Warehouses()), sweeps(0), evaluations(0)
+{}
+
+bool FLP_ParallelChangeSearch::BestMove(const FLP_Output& st, int s, FLP_Change& mv, CostType& delta, unsigned long long& evaluated) const
+{ // the moves of s in the order of NextMove: the first of the best ones is kept
+  int i;
+  CostType d;
+  FLP_Change current;
+  bool found = false;
+  current.store = s;
+  current.old_w1 = st.FirstSupplier(s);
+  current.old_w2 = st.SecondSupplier(s);
+  for (i = 0; i < in.PreferredSuppliers(s); i++)
+    for (Position pos : {Position::FIRST, Position::SECOND})
+      {
+        current.new_w_index = i;
+        current.new_w = in.PreferredSupplier(s,i);
+        current.pos = pos;
+        if (ne.FeasibleMove(st, current))
+          {
+            d = ne.DeltaCostFunctionComponents(st, current).total;
+            evaluated++;
+            if (d < 0 && (!found || d < delta))
+              {
+                mv = current;
+                delta = d;
+                found = true;
+              }
+          }
+      }
+  return found;
+}
+
+unsigned long FLP_ParallelChangeSearch::Descend(FLP_Output& st)
+{
+  unsigned long moves = 0;
+  unsigned i, t;
+  int s;
+  do
+    {
+      fill(thread_evaluations.begin(), thread_evaluations.end(), 0);
+      pool.ParallelFor(in.Stores(), CHUNK, [this, &st](unsigned t, int begin, int end)
+                       {
+                         int s;
+                         for (s = begin; s < end; s++)
+                           if (!BestMove(st, s, best_moves[s], best_delta[s], thread_evaluations[t]))
+                             best_delta[s] = 0;
+                       });
+      for (t = 0; t < pool.Size(); t++)
+        evaluations += thread_evaluations[t];
+      sweeps++;
+
+      improving.clear();
+      for (s = 0; s < in.Stores(); s++)
+        if (best_delta[s] < 0)
+          improving.push_back(s);
+      sort(improving.begin(), improving.end(), [this](int s1, int s2) 
+           { return make_pair(best_delta[s1], s1) < make_pair(best_delta[s2], s2); });
+      fill(touched.begin(), touched.end(), false);
+      for (i = 0; i < improving.size(); i++)
+        {
+          const FLP_Change& mv = best_moves[improving[i]];
+          if (touched[mv.new_w] || touched[mv.old_w1] || (mv.old_w2 != -1 && touched[mv.old_w2]))
+            continue;
+          touched[mv.new_w] = touched[mv.old_w1] = true;
+          if (mv.old_w2 != -1)
+            touched[mv.old_w2] = true;
+          ne.MakeMove(st, mv);
+          moves++;
+        }
+    }
+  while (!improving.empty());
+  return moves;
+}
+
+FLP_MultiStart::FLP_MultiStart(const FLP_Input& my_in, FLP_ThreadPool& my_pool, double rr, double tl, unsigned s)
+  : in(my_in), pool(my_pool), random_rate(rr), time_limit(tl), seed(s), constructions(0)
+{}
+
+void FLP_MultiStart::Run(int starts, unsigned keep)
+{ // the main thread (stream 0) is reset at the end, as if it had drawn nothing; the solution managers are
+  // objects of EasyLocal, so they are built here, on the calling thread, and only used by the workers
+  atomic<int> next(0);
+  exception_ptr failure; // of the first failed construction
+  chrono::time_point<chrono::steady_clock> start = chrono::steady_clock::now();
+  vector<unique_ptr<FLP_SolutionManager>> managers(pool.Size());
+  auto expired = [this, start]() 
+    { return time_limit > 0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() >= time_limit; };
+  for (unique_ptr<FLP_SolutionManager>& sm : managers)
+    sm.reset(new FLP_SolutionManager(in, false)); // capacities already checked
+  states.clear();
+  ranking.clear();
+  constructions = 0;
+  pool.Run([&](unsigned t)
+           {
+             int k;
+             unsigned i, worst;
+             CostType cost;
+             FLP_SolutionManager& sm = *managers[t];
+             FLP_Output st(in);
+             while ((k = next++) < starts)
+               { // the first construction is never stopped, so that there is a state anyway
+                 if (k > 0 && expired())
+                   break;
+                 sm.SetStop(k > 0 ? function<bool()>(expired) : nullptr);
+                 FLP_Random::SetStream(seed, k + 1);
+                 try
+                   {
+                     if (FLP_Random::Uniform(0.0,1.0) < random_rate)
+                       sm.RandomState(st);
+                     else
+                       sm.GreedyState(st);
+                   }
+                 catch (const FLP_ConstructionError& error)
+                   { // the other constructions go on, the error is raised only if all of them fail
+                     if (error.Reason() == "interrupted")
+                       break;
+                     lock_guard<mutex> lock(m);
+                     if (!failure)
+                       failure = current_exception();
+                     continue;
+                   }
+                 cost = st.ComputeCost();
+                 lock_guard<mutex> lock(m);
+                 constructions++;
+                 if (ranking.size() < keep)
+                   {
+                     states.push_back(st);
+                     ranking.push_back(make_pair(make_pair(cost, k), states.size() - 1));
+                   }
+                 else
+                   {
+                     for (worst = 0, i = 1; i < ranking.size(); i++)
+                       if (ranking[i].first > ranking[worst].first)
+                         worst = i;
+                     if (make_pair(cost, k) < ranking[worst].first)
+                       {
+                         states[ranking[worst].second] = st;
+                         ranking[worst].first = make_pair(cost, k);
+                       }
+                   }
+               }
+           });
+  sort(ranking.begin(), ranking.end());
+  FLP_Random::SetStream(seed, 0);
+  if (ranking.empty())
+    rethrow_exception(failure);
+}
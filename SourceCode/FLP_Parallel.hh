@@ -0,0 +1,102 @@
+// File FLP_Parallel.hh
+#ifndef FLP_PARALLEL_HH
+#define FLP_PARALLEL_HH
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "FLP_Helpers.hh"
+
+class FLP_ThreadPool
+{ // a fixed set of worker threads that execute the same task, each one with its own number
+  // (the calling thread takes part as number 0); Run returns when all of them have finished
+public:
+  FLP_ThreadPool(unsigned threads = 0); // 0 = as many as the hardware threads
+  ~FLP_ThreadPool();
+  unsigned Size() const { return workers.size() + 1; }
+  void Run(const function<void(unsigned)>& task);
+  // the blocks [begin,end) of at most chunk elements of [0,n) are handed out to the threads on
+  // demand; the results must not depend on which thread processes a block
+  void ParallelFor(int n, int chunk, const function<void(unsigned,int,int)>& body);
+private:
+  void Work(unsigned t);
+  vector<thread> workers;
+  mutex m;
+  condition_variable start, done;
+  const function<void(unsigned)>* task;
+  unsigned long long generation; // number of tasks started
+  unsigned running; // workers still busy with the current task
+  bool quit;
+};
+
+class FLP_ParallelClopenSearch
+{ // exhaustive exploration of the Clopen neighborhood split among the threads of a pool: each thread
+  // evaluates its blocks of move indices with its own move (whose transfer plan is the scratch buffer),
+  // and the best moves of the threads are reduced by (delta cost, index), so that the result does not
+  // depend on the number of threads
+public:
+  FLP_ParallelClopenSearch(const FLP_Input& in, const FLP_ClopenNeighborhoodExplorer& ne, FLP_ThreadPool& pool);
+  bool SelectBest(const FLP_Output& st, FLP_Clopen& mv, CostType& delta); // false if there is no feasible move
+  unsigned long Descend(FLP_Output& st); // steepest descent: returns the number of moves made
+  unsigned long long Evaluations() const { return evaluations; }
+private:
+  static const int CHUNK = 16;
+  const FLP_Input& in;
+  const FLP_ClopenNeighborhoodExplorer& ne;
+  FLP_ThreadPool& pool;
+  vector<FLP_Clopen> moves; // scratch move of each thread
+  vector<pair<CostType,int>> best; // best (delta cost, index) of each thread
+  vector<unsigned long long> thread_evaluations;
+  unsigned long long evaluations;
+};
+
+class FLP_ParallelChangeSearch
+{ // steepest descent on Change moves that commits many moves per sweep: the best improving move of 
+  // each store is computed in parallel, then the moves are taken by increasing (delta cost, store) as 
+  // long as they involve none of the warehouses of the moves already taken; such moves are independent,
+  // because the delta cost, the capacities and the compatibility of each one depend only on its own 
+  // warehouses (no other store enters or leaves them), so they are applied together
+public:
+  FLP_ParallelChangeSearch(const FLP_Input& in, const FLP_ChangeNeighborhoodExplorer& ne, FLP_ThreadPool& pool);
+  unsigned long Descend(FLP_Output& st); // returns the number of moves made
+  unsigned long Sweeps() const { return sweeps; }
+  unsigned long long Evaluations() const { return evaluations; }
+private:
+  bool BestMove(const FLP_Output& st, int s, FLP_Change& mv, CostType& delta, unsigned long long& evaluated) const;
+  static const int CHUNK = 32;
+  const FLP_Input& in;
+  const FLP_ChangeNeighborhoodExplorer& ne;
+  FLP_ThreadPool& pool;
+  vector<FLP_Change> best_moves; // best improving move of each store
+  vector<CostType> best_delta; // (0 if none)
+  vector<unsigned long long> thread_evaluations;
+  vector<int> improving; // stores with an improving move
+  vector<bool> touched; // warehouses involved in the moves of the current batch
+  unsigned long sweeps;
+  unsigned long long evaluations;
+};
+
+class FLP_MultiStart
+{ // randomized constructions (greedy, or RandomState with probability random_rate) run concurrently on the
+  // threads of a pool, each with its own solution manager; the k-th construction draws from the random
+  // stream (seed, k + 1), so its result does not depend on the thread; when time_limit seconds have passed
+  // (0 = no limit) the constructions running are stopped and the others skipped, but the first one, and the
+  // keep best states are kept
+public:
+  FLP_MultiStart(const FLP_Input& in, FLP_ThreadPool& pool, double random_rate, double time_limit, unsigned seed);
+  void Run(int starts, unsigned keep); // throws the FLP_ConstructionError of a start if all of them fail
+  unsigned Kept() const { return ranking.size(); }
+  const FLP_Output& State(unsigned i) const { return states[ranking[i].second]; } // by increasing cost
+  CostType Cost(unsigned i) const { return ranking[i].first.first; }
+  int Constructions() const { return constructions; }
+private:
+  const FLP_Input& in;
+  FLP_ThreadPool& pool;
+  double random_rate, time_limit;
+  unsigned seed;
+  mutex m;
+  vector<FLP_Output> states;
+  vector<pair<pair<CostType,int>,unsigned>> ranking; // ((cost, construction), position in states)
+  int constructions;
+};
+#endif
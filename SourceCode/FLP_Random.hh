@@ -0,0 +1,116 @@
+// File FLP_Random.hh
+#ifndef FLP_RANDOM_HH
+#define FLP_RANDOM_HH
+#include <cstdint>
+#include <atomic>
+#include <random>
+
+using namespace std;
+
+inline uint64_t SplitMix64(uint64_t& x)
+{ // used to expand seeds into generator states
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+class Xoshiro256StarStar
+{ // xoshiro256** generator (Blackman and Vigna), it satisfies UniformRandomBitGenerator
+public:
+  typedef uint64_t result_type;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~static_cast<result_type>(0); }
+  Xoshiro256StarStar(uint64_t seed = 0) { this->seed(seed); }
+  void seed(uint64_t seed)
+  {
+    for (int i = 0; i < 4; i++)
+      state[i] = SplitMix64(seed);
+  }
+  result_type operator()()
+  {
+    const uint64_t result = Rotate(state[1] * 5, 7) * 9, t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = Rotate(state[3], 45);
+    return result;
+  }
+private:
+  static uint64_t Rotate(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+  uint64_t state[4];
+};
+
+// the engine is selected at compile time (-DFLP_RANDOM_MT19937 restores the Mersenne twister)
+#ifdef FLP_RANDOM_MT19937
+typedef mt19937_64 FLP_RandomEngine;
+#else
+typedef Xoshiro256StarStar FLP_RandomEngine;
+#endif
+
+class FLP_Random
+{ // per-thread generators used by the solution manager and the neighborhood explorers: each thread draws
+  // from the stream (seed, stream) it was last set to; there is no shared seed, so concurrent solvers (and
+  // their pools, which receive the seed explicitly) do not interfere; a thread never set draws from (0, i),
+  // being the i-th such thread
+public:
+  static void SetSeed(unsigned s) { SetStream(s, 0); } // the calling thread only
+  static unsigned Seed() { return Local().seed; } // of the calling thread
+  static void SetStream(uint64_t stream) { SetStream(Local().seed, stream); } // same seed, another stream
+  static void SetStream(unsigned seed, uint64_t stream)
+  {
+    Generator& g = Local();
+    uint64_t x = (static_cast<uint64_t>(seed) << 32) ^ stream;
+    g.engine.seed(SplitMix64(x));
+    g.next = BATCH;
+    g.seed = seed;
+  }
+  static int Uniform(int a, int b)
+  { // bias-free bounded generation (Lemire's multiply and reject)
+    uint32_t range = static_cast<uint32_t>(b - a) + 1;
+    uint64_t m = Bits32() * static_cast<uint64_t>(range);
+    uint32_t low = static_cast<uint32_t>(m);
+    if (low < range)
+      {
+        uint32_t threshold = -range % range;
+        while (low < threshold)
+          {
+            m = Bits32() * static_cast<uint64_t>(range);
+            low = static_cast<uint32_t>(m);
+          }
+      }
+    return a + static_cast<int>(m >> 32);
+  }
+  static double Uniform(double a, double b) { return a + (b - a) * Uniform01(); }
+  static double Uniform01()
+  { // uniform in [0,1), taken from a batch of precomputed draws
+    Generator& g = Local();
+    if (g.next == BATCH)
+      {
+        for (int i = 0; i < BATCH; i++)
+          g.batch[i] = (g.engine() >> 11) * 0x1.0p-53;
+        g.next = 0;
+      }
+    return g.batch[g.next++];
+  }
+private:
+  static const int BATCH = 64;
+  struct Generator
+  {
+    FLP_RandomEngine engine;
+    double batch[BATCH];
+    int next = BATCH;
+    unsigned seed = 0;
+    Generator() { uint64_t x = Threads()++; engine.seed(SplitMix64(x)); }
+  };
+  static Generator& Local()
+  {
+    static thread_local Generator g;
+    return g;
+  }
+  static uint64_t Bits32() { return Local().engine() >> 32; }
+  static atomic<uint64_t>& Threads() { static atomic<uint64_t> threads(0); return threads; }
+};
+#endif
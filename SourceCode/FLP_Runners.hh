@@ -0,0 +1,137 @@
+// File FLP_Runners.hh
+#ifndef FLP_RUNNERS_HH
+#define FLP_RUNNERS_HH
+#include <functional>
+#include <chrono>
+#include "FLP_Helpers.hh"
+#include "FLP_Checkpoint.hh"
+
+template <class BaseRunner>
+class FLP_MonitoredRunner : public BaseRunner
+{ // a runner that can be stopped from outside the search: every CHECK_INTERVAL iterations the
+  // monitor is called with the cost of the best state, and the run stops if it returns true;
+  // moreover, an action (e.g. a polishing step) can be applied to the current state periodically
+public:
+  using BaseRunner::BaseRunner;
+  void SetMonitor(function<bool(CostType)> m) { monitor = m; }
+  void SetPeriodicAction(function<bool(FLP_Output&)> a, unsigned long interval) 
+  { action = a; action_interval = interval; } // a returns true if it has modified the state
+protected:
+  static const unsigned long CHECK_INTERVAL = 1024;
+  bool StopCriterion() const override
+  {
+    return BaseRunner::StopCriterion()
+      || (monitor && this->iteration % CHECK_INTERVAL == 0 && monitor(this->best_state_cost.total));
+  }
+  void CompleteIteration() override
+  {
+    BaseRunner::CompleteIteration();
+    if (action && action_interval > 0 && this->iteration % action_interval == action_interval - 1
+        && action(*this->current_state))
+      {
+        this->current_state_cost = this->sm.CostFunctionComponents(*this->current_state);
+        if (this->current_state_cost.total < this->best_state_cost.total)
+          {
+            *this->best_state = *this->current_state;
+            this->best_state_cost = this->current_state_cost;
+          }
+      }
+  }
+  function<bool(CostType)> monitor;
+  function<bool(FLP_Output&)> action;
+  unsigned long action_interval = 0;
+};
+
+template <class BaseRunner>
+class FLP_AnnealingRunner : public FLP_MonitoredRunner<BaseRunner>
+{ // a simulated annealing that can start at start_temperature * ratio (not below min_temperature), because a
+  // warm start is already a good solution that the first, hot part of the schedule would only scatter; it can
+  // also save checkpoints at the start of its temperature levels (epochs), and resume from one of them
+public:
+  using FLP_MonitoredRunner<BaseRunner>::FLP_MonitoredRunner;
+  void SetTemperatureRatio(double r) { ratio = r; }
+  // with a save function (and in resumed runs), the generators are reseeded at each epoch from the seed and the
+  // epoch, and the first epoch after interval seconds from the previous checkpoint is saved (time based schedules
+  // stay at min_temperature until the end: there, every interval seconds is a new epoch)
+  void SetCheckpoint(function<void(FLP_Checkpoint&)> s, double interval, unsigned seed)
+  { save = s; checkpoint_interval = interval; checkpoint_seed = seed; }
+  // the next run starts from checkpoint c (its current state is the one passed to the run)
+  void SetResume(const FLP_Checkpoint* c, const FLP_Output* best) { resume = c; resume_best = best; }
+  unsigned long long RunEvaluations() const { return this->Evaluations() - start_evaluations + evaluations_offset; }
+protected:
+  void InitializeRun() override
+  { // the time based schedule is computed on the lowered start_temperature, that is then restored
+    double start_temperature = this->start_temperature;
+    if (resume != nullptr)
+      this->start_temperature = resume->temperature;
+    else
+      this->start_temperature = max<double>(start_temperature * ratio, this->min_temperature);
+    FLP_MonitoredRunner<BaseRunner>::InitializeRun();
+    this->start_temperature = start_temperature;
+    run_start = last_checkpoint = chrono::steady_clock::now();
+    start_evaluations = this->Evaluations();
+    last_temperature = this->temperature;
+    epoch = evaluations_offset = 0;
+    elapsed_offset = 0.0;
+    reseeding = save || resume != nullptr; // a resumed run draws as the run that saved the checkpoint
+    if (resume != nullptr)
+      {
+        *this->best_state = *resume_best;
+        this->best_state_cost = this->sm.CostFunctionComponents(*this->best_state);
+        this->iteration = resume->iteration;
+        epoch = resume->epoch;
+        evaluations_offset = resume->evaluations;
+        elapsed_offset = resume->elapsed;
+        resume = nullptr;
+      }
+    if (reseeding)
+      Reseed();
+  }
+  void CompleteIteration() override
+  {
+    FLP_MonitoredRunner<BaseRunner>::CompleteIteration();
+    if (!reseeding)
+      return;
+    if (this->temperature != last_temperature)
+      {
+        last_temperature = this->temperature;
+        NewEpoch();
+      }
+    else if (this->temperature <= this->min_temperature && this->iteration % this->CHECK_INTERVAL == 0 && Due())
+      NewEpoch();
+  }
+  bool Due() const
+  { return chrono::duration<double>(chrono::steady_clock::now() - last_checkpoint).count() >= checkpoint_interval; }
+  void NewEpoch()
+  {
+    epoch++;
+    Reseed();
+    if (!save || !Due())
+      return;
+    last_checkpoint = chrono::steady_clock::now();
+    checkpoint.epoch = epoch;
+    checkpoint.iteration = this->iteration + 1; // the current one is complete
+    checkpoint.evaluations = RunEvaluations();
+    checkpoint.temperature = this->temperature;
+    checkpoint.elapsed = elapsed_offset + chrono::duration<double>(last_checkpoint - run_start).count();
+    checkpoint.Take(this->in, *this->current_state, *this->best_state);
+    save(checkpoint);
+  }
+  void Reseed()
+  { // both the generator of EasyLocal (acceptance) and the one of the explorers (moves)
+    Random::SetSeed(checkpoint_seed ^ static_cast<unsigned>(epoch * 0x9e3779b9ULL));
+    FLP_Random::SetStream(checkpoint_seed, (1ULL << 63) | epoch);
+  }
+  double ratio = 1.0;
+  function<void(FLP_Checkpoint&)> save;
+  bool reseeding = false;
+  double checkpoint_interval = 0.0, elapsed_offset = 0.0;
+  unsigned checkpoint_seed = 0;
+  const FLP_Checkpoint* resume = nullptr;
+  const FLP_Output* resume_best = nullptr;
+  FLP_Checkpoint checkpoint;
+  double last_temperature = 0.0;
+  unsigned long long epoch = 0, start_evaluations = 0, evaluations_offset = 0;
+  chrono::time_point<chrono::steady_clock> run_start, last_checkpoint;
+};
+#endif
@@ -0,0 +1,686 @@
+// File FLP_Search.cc
+#include <cmath>
+#include "FLP_Search.hh"
+
+void FLP_BestAssignments::Start(const FLP_Output& st)
+{
+  int s;
+  for (s = 0; s < static_cast<int>(best.size()); s++)
+    {
+      best[s] = st.Assignment(s);
+      is_changed[s] = false;
+    }
+  changed.clear();
+}
+
+void FLP_BestAssignments::ChangeAll()
+{
+  int s;
+  for (s = 0; s < static_cast<int>(best.size()); s++)
+    Change(s);
+}
+
+void FLP_BestAssignments::Save(const FLP_Output& st)
+{ // only the stores changed since the previous best state are copied
+  for (int s : changed)
+    {
+      best[s] = st.Assignment(s);
+      is_changed[s] = false;
+    }
+  changed.clear();
+}
+
+void FLP_BestAssignments::Restore(FLP_Output& st)
+{ // the changed stores are all removed before being reassigned, so the capacities are never exceeded
+  for (int s : changed)
+    st.Unassign(s);
+  for (int s : changed)
+    {
+      st.AssignFirst(s, best[s].w1, best[s].q1);
+      if (best[s].w2 != -1)
+        st.AssignSecond(s, best[s].w2, best[s].q2);
+      is_changed[s] = false;
+    }
+  changed.clear();
+}
+
+FLP_LNS::FLP_LNS(const FLP_Input& my_in, int mr, double st, double mt)
+  : in(my_in), max_removed(mr), start_temperature(st), min_temperature(mt),
+    is_removed(in.Stores(),false), in_region(in.Warehouses(),false), best(in),
+    is_touched(in.Warehouses(),false), was_open(in.Warehouses(),false),
+    supply_delta(0), accepted(0), failed_repairs(0)
+{}
+
+CostType FLP_LNS::Run(FLP_Output& st, unsigned long iterations)
+{
+  unsigned long it;
+  int i, j;
+  bool repaired;
+  double temperature;
+  CostType delta, current_cost = st.ComputeCost(), best_cost = current_cost;
+
+  best.Start(st);
+
+  for (it = 0; it < iterations; it++)
+    { // the temperature decreases geometrically from start_temperature to min_temperature
+      if (monitor && it % CHECK_INTERVAL == 0 && monitor(best_cost))
+        break;
+      temperature = start_temperature * pow(min_temperature / start_temperature, static_cast<double>(it) / iterations);
+      st.StartJournal();
+      supply_delta = 0;
+      if (FLP_Random::Uniform(0.0,1.0) < 0.5)
+        DestroyRegion(st);
+      else
+        DestroyCluster(st);
+
+      for (i = removed.size() - 1; i > 0; i--) // reinsertion in random order
+        {
+          j = FLP_Random::Uniform(0, i);
+          swap(removed[i], removed[j]);
+        }
+      repaired = true;
+      for (i = 0; i < static_cast<int>(removed.size()) && repaired; i++)
+        repaired = Insert(st, removed[i]);
+
+      if (repaired)
+        delta = Delta(st);
+      if (repaired && (delta <= 0 || FLP_Random::Uniform(0.0,1.0) < exp(-delta / temperature)))
+        {
+          st.Commit();
+          current_cost += delta;
+          accepted++;
+          for (int s : removed)
+            best.Change(s);
+          if (current_cost < best_cost)
+            {
+              best.Save(st);
+              best_cost = current_cost;
+            }
+        }
+      else
+        {
+          if (!repaired)
+            failed_repairs++;
+          st.Rollback();
+        }
+
+      for (int s : removed)
+        is_removed[s] = false;
+      for (int w : touched)
+        is_touched[w] = false;
+      for (int w : region)
+        in_region[w] = false;
+      removed.clear();
+      touched.clear();
+      region.clear();
+    }
+  best.Restore(st);
+  return best_cost;
+}
+
+void FLP_LNS::DestroyRegion(FLP_Output& st)
+{ // the clients of an open warehouse, then of open preferred suppliers of the stores removed so far
+  int i, k, w, s;
+  do
+    w = FLP_Random::Uniform(0, in.Warehouses() - 1);
+  while (st.Closed(w));
+  while (w != -1)
+    {
+      region.push_back(w);
+      in_region[w] = true;
+      while (st.Clients(w) > 0)
+        Remove(st, st.Client(w,0));
+      if (static_cast<int>(removed.size()) >= max_removed)
+        break;
+      candidates.clear();
+      for (i = 0; i < static_cast<int>(removed.size()); i++)
+        {
+          s = removed[i];
+          for (k = 0; k < in.PreferredSuppliers(s); k++)
+            if (st.Open(in.PreferredSupplier(s,k)) && !in_region[in.PreferredSupplier(s,k)])
+              candidates.push_back(in.PreferredSupplier(s,k));
+        }
+      w = candidates.empty() ? -1 : candidates[FLP_Random::Uniform(0, static_cast<int>(candidates.size()) - 1)];
+    }
+}
+
+void FLP_LNS::DestroyCluster(FLP_Output& st)
+{ // a store with incompatibilities, then (breadth first) the stores incompatible with the removed ones
+  const int ATTEMPTS = 10;
+  int i, k, s, s2, attempt = 0;
+  do
+    s = FLP_Random::Uniform(0, in.Stores() - 1);
+  while (in.StoreIncompatibilities(s) == 0 && ++attempt < ATTEMPTS);
+  if (in.StoreIncompatibilities(s) == 0)
+    {
+      DestroyRegion(st);
+      return;
+    }
+  Remove(st, s);
+  for (i = 0; i < static_cast<int>(removed.size()) && static_cast<int>(removed.size()) < max_removed; i++)
+    for (k = 0; k < in.StoreIncompatibilities(removed[i]) && static_cast<int>(removed.size()) < max_removed; k++)
+      {
+        s2 = in.StoreIncompatibility(removed[i],k);
+        if (!is_removed[s2])
+          Remove(st, s2);
+      }
+}
+
+void FLP_LNS::Remove(FLP_Output& st, int s)
+{
+  Touch(st, st.FirstSupplier(s));
+  supply_delta -= st.FirstQuantity(s) * in.SupplyCost(s,st.FirstSupplier(s));
+  if (st.SecondSupplier(s) != -1)
+    {
+      Touch(st, st.SecondSupplier(s));
+      supply_delta -= st.SecondQuantity(s) * in.SupplyCost(s,st.SecondSupplier(s));
+    }
+  st.Unassign(s);
+  removed.push_back(s);
+  is_removed[s] = true;
+}
+
+bool FLP_LNS::Insert(FLP_Output& st, int s)
+{ // the cheapest single supplier (supply plus fixed cost, if closed) with enough space, otherwise the
+  // supplier with the cheapest unit cost gets as much as possible and the cheapest single one the rest
+  int i, w, w1 = -1, q1 = 0, w2 = -1, d = in.AmountOfGoods(s);
+  double cost, best_cost = 0.0;
+
+  for (i = 0; i < in.PreferredSuppliers(s); i++)
+    {
+      w = in.PreferredSupplier(s,i);
+      if (st.Compatible(s,w) && st.ResidualCapacity(w) >= d)
+        {
+          cost = d * in.PreferredSupplierCost(s,i) + (st.Closed(w) ? in.FixedCost(w) : 0);
+          if (w1 == -1 || cost < best_cost)
+            {
+              w1 = w;
+              best_cost = cost;
+            }
+        }
+    }
+  if (w1 != -1)
+    {
+      Touch(st, w1);
+      st.FullAssign(s, w1);
+      supply_delta += d * in.SupplyCost(s,w1);
+      return true;
+    }
+
+  for (i = 0; i < in.PreferredSuppliers(s); i++)
+    {
+      w = in.PreferredSupplier(s,i);
+      if (st.Compatible(s,w) && st.ResidualCapacity(w) > 0)
+        {
+          cost = in.PreferredSupplierCost(s,i) + (st.Closed(w) ? static_cast<double>(in.FixedCost(w)) / st.ResidualCapacity(w) : 0.0);
+          if (w1 == -1 || cost < best_cost)
+            {
+              w1 = w;
+              best_cost = cost;
+            }
+        }
+    }
+  if (w1 == -1)
+    return false;
+  q1 = min(st.ResidualCapacity(w1), d - 1);
+  for (i = 0; i < in.PreferredSuppliers(s); i++)
+    {
+      w = in.PreferredSupplier(s,i);
+      if (w != w1 && st.Compatible(s,w) && st.ResidualCapacity(w) >= d - q1)
+        {
+          cost = (d - q1) * in.PreferredSupplierCost(s,i) + (st.Closed(w) ? in.FixedCost(w) : 0);
+          if (w2 == -1 || cost < best_cost)
+            {
+              w2 = w;
+              best_cost = cost;
+            }
+        }
+    }
+  if (w2 == -1)
+    return false;
+  Touch(st, w1);
+  Touch(st, w2);
+  st.AssignFirst(s, w1, q1);
+  st.AssignSecond(s, w2, d - q1);
+  supply_delta += q1 * in.SupplyCost(s,w1) + (d - q1) * in.SupplyCost(s,w2);
+  return true;
+}
+
+void FLP_LNS::Touch(const FLP_Output& st, int w)
+{
+  if (!is_touched[w])
+    {
+      is_touched[w] = true;
+      was_open[w] = st.Open(w);
+      touched.push_back(w);
+    }
+}
+
+CostType FLP_LNS::Delta(const FLP_Output& st) const
+{
+  CostType delta = supply_delta;
+  for (int w : touched)
+    if (st.Open(w) != was_open[w])
+      delta += st.Open(w) ? in.FixedCost(w) : -in.FixedCost(w);
+  return delta;
+}
+
+FLP_ILS::FLP_ILS(const FLP_Input& my_in, const FLP_ChangeNeighborhoodExplorer& my_cnhe, const FLP_SwapNeighborhoodExplorer& my_snhe, 
+                 const FLP_ClopenNeighborhoodExplorer& my_knhe, int kl, double t)
+  : in(my_in), cnhe(my_cnhe), snhe(my_snhe), knhe(my_knhe), kick_length(kl), threshold(t),
+    queued(in.Stores(),false), best(in), accepted(0), descent_moves(0)
+{}
+
+CostType FLP_ILS::Run(FLP_Output& st, unsigned long iterations)
+{
+  unsigned long it;
+  int s, i;
+  CostType current_cost, best_cost, delta;
+
+  for (s = 0; s < in.Stores(); s++)
+    Enqueue(s);
+  current_cost = st.ComputeCost() + Descend(st);
+  best_cost = current_cost;
+  best.Start(st);
+  for (it = 0; it < iterations; it++)
+    {
+      if (monitor && it % CHECK_INTERVAL == 0 && monitor(best_cost))
+        break;
+      st.StartJournal();
+      delta = Kick(st);
+      delta += Descend(st);
+      if (current_cost + delta <= best_cost * (1.0 + threshold))
+        {
+          for (i = 0; i < st.JournalEntries(); i++)
+            best.Change(st.JournalStore(i));
+          st.Commit();
+          current_cost += delta;
+          accepted++;
+          if (current_cost < best_cost)
+            {
+              best.Save(st);
+              best_cost = current_cost;
+            }
+        }
+      else
+        st.Rollback();
+    }
+  best.Restore(st);
+  return best_cost;
+}
+
+CostType FLP_ILS::Kick(FLP_Output& st)
+{ // the warehouses of the transfers are opened, closed, or change their residual capacities (see EnqueueTouched)
+  int k;
+  unsigned i;
+  CostType delta = 0;
+  FLP_Clopen mv;
+  for (k = 0; k < kick_length; k++)
+    {
+      knhe.RandomMove(st, mv);
+      delta += FusedDelta(in, st, mv);
+      for (i = 0; i < mv.transfer.size(); i++)
+        {
+          Touch(st, mv.transfer[i].from_w);
+          Touch(st, mv.transfer[i].to_w);
+        }
+      knhe.MakeMove(st, mv);
+      EnqueueTouched(st);
+    }
+  return delta;
+}
+
+CostType FLP_ILS::Descend(FLP_Output& st)
+{ // each move queues the stores whose moves may have changed because of the warehouses involved (EnqueueTouched)
+  int s;
+  CostType delta = 0, change_delta, swap_delta;
+  bool change_found, swap_found;
+  FLP_Change cmv;
+  FLP_Swap smv;
+  while (!queue.empty())
+    {
+      s = queue.back();
+      queue.pop_back();
+      queued[s] = false;
+      change_found = BestChange(st, s, cmv, change_delta);
+      swap_found = BestSwap(st, s, smv, swap_delta);
+      if (change_found && (!swap_found || change_delta <= swap_delta))
+        {
+          delta += change_delta;
+          Touch(st, cmv.new_w);
+          Touch(st, cmv.old_w1);
+          if (cmv.old_w2 != -1)
+            Touch(st, cmv.old_w2);
+          cnhe.MakeMove(st, cmv);
+          EnqueueTouched(st);
+          Enqueue(s);
+        }
+      else if (swap_found)
+        {
+          delta += swap_delta;
+          Touch(st, smv.w1);
+          Touch(st, smv.w2);
+          snhe.MakeMove(st, smv);
+          EnqueueTouched(st);
+        }
+      else
+        continue;
+      descent_moves++;
+    }
+  return delta;
+}
+
+bool FLP_ILS::BestChange(const FLP_Output& st, int s, FLP_Change& mv, CostType& delta) const
+{ // the best improving Change move of s
+  int i;
+  CostType d;
+  FLP_Change current;
+  bool found = false;
+  current.store = s;
+  current.old_w1 = st.FirstSupplier(s);
+  current.old_w2 = st.SecondSupplier(s);
+  for (i = 0; i < in.PreferredSuppliers(s); i++)
+    for (Position pos : {Position::FIRST, Position::SECOND})
+      {
+        current.new_w_index = i;
+        current.new_w = in.PreferredSupplier(s,i);
+        current.pos = pos;
+        if (cnhe.FeasibleMove(st, current))
+          {
+            d = FusedDelta(in, st, current);
+            if (d < 0 && (!found || d < delta))
+              {
+                mv = current;
+                delta = d;
+                found = true;
+              }
+          }
+      }
+  return found;
+}
+
+bool FLP_ILS::BestSwap(const FLP_Output& st, int s, FLP_Swap& mv, CostType& delta) const
+{ // the best improving Swap move of s with the preferred clients of its suppliers (as in RandomMove)
+  int i, s2;
+  CostType d;
+  FLP_Swap current;
+  bool found = false;
+  current.s1 = s;
+  for (Position pos1 : {Position::FIRST, Position::SECOND})
+    {
+      current.pos1 = pos1;
+      current.w1 = pos1 == Position::FIRST ? st.FirstSupplier(s) : st.SecondSupplier(s);
+      current.q1 = pos1 == Position::FIRST ? st.FirstQuantity(s) : st.SecondQuantity(s);
+      if (current.w1 == -1)
+        continue;
+      for (i = 0; i < in.PreferredClients(current.w1); i++)
+        {
+          s2 = in.PreferredClient(current.w1,i);
+          if (s2 == s)
+            continue;
+          for (Position pos2 : {Position::FIRST, Position::SECOND})
+            {
+              current.s2 = s2;
+              current.pos2 = pos2;
+              current.w2 = pos2 == Position::FIRST ? st.FirstSupplier(s2) : st.SecondSupplier(s2);
+              current.q2 = pos2 == Position::FIRST ? st.FirstQuantity(s2) : st.SecondQuantity(s2);
+              if (current.w2 == -1 || !snhe.FeasibleMove(st, current))
+                continue;
+              d = FusedDelta(in, st, current);
+              if (d < 0 && (!found || d < delta))
+                {
+                  mv = current;
+                  delta = d;
+                  found = true;
+                }
+            }
+        }
+    }
+  return found;
+}
+
+void FLP_ILS::Enqueue(int s)
+{
+  if (!queued[s])
+    {
+      queued[s] = true;
+      queue.push_back(s);
+    }
+}
+
+void FLP_ILS::Touch(const FLP_Output& st, int w)
+{
+  touched.push_back({w, st.ResidualCapacity(w), st.Open(w)});
+}
+
+void FLP_ILS::EnqueueTouched(const FLP_Output& st)
+{ // the clients of the warehouses touched by a move, and the stores that prefer a warehouse that has been opened
+  // (no fixed cost any more) or that has stayed open and gained room, if they have an improving Change into it:
+  // only that move is new for them, and checking it is much cheaper than a full examination of the store
+  int i, s;
+  for (const Touched& t : touched)
+    {
+      for (i = 0; i < st.Clients(t.w); i++)
+        Enqueue(st.Client(t.w,i));
+      if (st.Open(t.w) && (!t.open || st.ResidualCapacity(t.w) > t.residual))
+        for (i = 0; i < in.PreferredClients(t.w); i++)
+          {
+            s = in.PreferredClient(t.w,i);
+            if (!queued[s] && ImprovingChange(st, s, t.w))
+              Enqueue(s);
+          }
+    }
+  touched.clear();
+}
+
+bool FLP_ILS::ImprovingChange(const FLP_Output& st, int s, int w) const
+{ // whether s has an improving Change move into w
+  int i;
+  FLP_Change mv;
+  mv.store = s;
+  mv.old_w1 = st.FirstSupplier(s);
+  mv.old_w2 = st.SecondSupplier(s);
+  mv.new_w = w;
+  for (i = 0; in.PreferredSupplier(s,i) != w; i++)
+    ;
+  mv.new_w_index = i;
+  for (Position pos : {Position::FIRST, Position::SECOND})
+    {
+      mv.pos = pos;
+      if (cnhe.FeasibleMove(st, mv) && FusedDelta(in, st, mv) < 0)
+        return true;
+    }
+  return false;
+}
+
+bool FLP_ElitePool::Insert(const FLP_Output& st, CostType cost)
+{
+  unsigned i, worst = 0;
+  if (Contains(st))
+    {
+      rejected++;
+      return false;
+    }
+  if (states.size() < capacity)
+    {
+      states.push_back(st);
+      costs.push_back(cost);
+    }
+  else
+    {
+      for (i = 1; i < states.size(); i++)
+        if (costs[i] > costs[worst])
+          worst = i;
+      if (capacity == 0 || cost >= costs[worst])
+        return false;
+      hashes.erase(states[worst].Hash());
+      states[worst] = st;
+      costs[worst] = cost;
+    }
+  hashes.insert(st.Hash());
+  return true;
+}
+
+FLP_HashedTabuSearch::FLP_HashedTabuSearch(const FLP_Input& my_in, const FLP_ChangeNeighborhoodExplorer& my_cnhe, const FLP_SwapNeighborhoodExplorer& my_snhe, 
+                                           double sr, int sa, unsigned long t, unsigned e, unsigned long r)
+  : in(my_in), cnhe(my_cnhe), snhe(my_snhe), swap_rate(sr), samples(sa), tenure(t), restart(r), pool(e), best(in),
+    recent(max(tenure, 1UL), 0), next(0), tabu_hits(0), restarts(0)
+{}
+
+CostType FLP_HashedTabuSearch::Run(FLP_Output& st, unsigned long iterations)
+{ // the best state is saved from the stores changed since the previous one (all of them after a restart),
+  // the local minima are copied in the pool
+  unsigned long it, idle = 0;
+  int k;
+  bool found, is_swap = false, descending = false;
+  unsigned long long h, best_h = 0;
+  CostType delta, best_delta = 0, current_cost = st.ComputeCost(), best_cost = current_cost;
+  FLP_Change cmv, best_cmv;
+  FLP_Swap smv, best_smv;
+
+  best.Start(st);
+  Visit(st.Hash());
+  for (it = 0; it < iterations; it++)
+    {
+      if (monitor && it % CHECK_INTERVAL == 0 && monitor(best_cost))
+        break;
+      found = false;
+      for (k = 0; k < samples; k++)
+        {
+          if (FLP_Random::Uniform(0.0,1.0) < swap_rate)
+            {
+              snhe.RandomMove(st, smv);
+              delta = FusedDelta(in, st, smv);
+              if (found && delta >= best_delta)
+                continue;
+              h = HashAfter(st, smv);
+              if (Tabu(h) && current_cost + delta >= best_cost)
+                {
+                  tabu_hits++;
+                  continue;
+                }
+              best_smv = smv;
+              is_swap = true;
+            }
+          else
+            {
+              cnhe.RandomMove(st, cmv);
+              delta = FusedDelta(in, st, cmv);
+              if (found && delta >= best_delta)
+                continue;
+              h = HashAfter(st, cmv);
+              if (Tabu(h) && current_cost + delta >= best_cost)
+                {
+                  tabu_hits++;
+                  continue;
+                }
+              best_cmv = cmv;
+              is_swap = false;
+            }
+          best_delta = delta;
+          best_h = h;
+          found = true;
+        }
+      if (!found)
+        continue;
+      if (best_delta >= 0 && descending) // st is a local minimum
+        pool.Insert(st, current_cost);
+      descending = best_delta < 0;
+      if (is_swap)
+        {
+          best.Change(best_smv.s1);
+          best.Change(best_smv.s2);
+          snhe.MakeMove(st, best_smv);
+        }
+      else
+        {
+          best.Change(best_cmv.store);
+          cnhe.MakeMove(st, best_cmv);
+        }
+      current_cost += best_delta;
+      Visit(best_h);
+      if (current_cost < best_cost)
+        {
+          best.Save(st);
+          best_cost = current_cost;
+          idle = 0;
+        }
+      else if (restart > 0 && ++idle >= restart && pool.Size() > 0)
+        {
+          k = FLP_Random::Uniform(0, static_cast<int>(pool.Size()) - 1);
+          best.ChangeAll();
+          st = pool.State(k);
+          current_cost = pool.Cost(k);
+          descending = false;
+          idle = 0;
+          restarts++;
+        }
+    }
+  best.Restore(st);
+  return best_cost;
+}
+
+Suppliers FLP_HashedTabuSearch::Replaced(const FLP_Output& st, int s, Position pos, int w, int q) const
+{
+  Suppliers sup = st.Assignment(s);
+  int other = pos == Position::FIRST ? sup.w2 : sup.w1;
+  if (w == other)
+    { // the two supplies are merged
+      sup.w1 = w;
+      sup.q1 = in.AmountOfGoods(s);
+      sup.w2 = -1;
+      sup.q2 = 0;
+    }
+  else if (pos == Position::FIRST)
+    {
+      sup.w1 = w;
+      sup.q1 = q;
+    }
+  else
+    {
+      sup.w2 = w;
+      sup.q2 = q;
+    }
+  return sup;
+}
+
+unsigned long long FLP_HashedTabuSearch::HashAfter(const FLP_Output& st, const FLP_Change& mv) const
+{ // see ChangeFirstSupplierAndQuantity and ChangeSecondSupplierAndQuantity
+  Suppliers sup;
+  int d = in.AmountOfGoods(mv.store);
+  if (mv.pos == Position::FIRST)
+    {
+      sup.w1 = mv.new_w;
+      sup.q1 = mv.new_q;
+      sup.w2 = mv.old_w2;
+      sup.q2 = d - mv.new_q;
+    }
+  else
+    {
+      sup.w1 = mv.old_w1;
+      sup.q1 = d - mv.new_q;
+      sup.w2 = mv.new_q == 0 ? -1 : mv.new_w;
+      sup.q2 = mv.new_q;
+    }
+  return st.Hash() ^ st.HashChange(mv.store, sup);
+}
+
+unsigned long long FLP_HashedTabuSearch::HashAfter(const FLP_Output& st, const FLP_Swap& mv) const
+{
+  return st.Hash() ^ st.HashChange(mv.s1, Replaced(st, mv.s1, mv.pos1, mv.w2, mv.q1))
+    ^ st.HashChange(mv.s2, Replaced(st, mv.s2, mv.pos2, mv.w1, mv.q2));
+}
+
+void FLP_HashedTabuSearch::Visit(unsigned long long h)
+{ // the hash leaving the window is forgotten, unless it is still in it
+  unordered_map<unsigned long long,int>::iterator i;
+  if (next >= recent.size())
+    {
+      i = visited.find(recent[next % recent.size()]);
+      if (--i->second == 0)
+        visited.erase(i);
+    }
+  recent[next % recent.size()] = h;
+  visited[h]++;
+  next++;
+}
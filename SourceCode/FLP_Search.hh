@@ -0,0 +1,159 @@
+// File FLP_Search.hh
+#ifndef FLP_SEARCH_HH
+#define FLP_SEARCH_HH
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include "FLP_Helpers.hh"
+
+class FLP_BestAssignments
+{ // the assignments of the best state of a search, saved and restored in time proportional to the number of
+  // stores changed since the previous save (the search reports them by Change)
+public:
+  FLP_BestAssignments(const FLP_Input& in) : best(in.Stores()), is_changed(in.Stores(),false) {}
+  void Start(const FLP_Output& st); // O(S)
+  void Change(int s) { if (!is_changed[s]) { is_changed[s] = true; changed.push_back(s); } }
+  void ChangeAll(); // after the state has been replaced
+  void Save(const FLP_Output& st);
+  void Restore(FLP_Output& st);
+private:
+  vector<Suppliers> best; // up to date but for the changed stores
+  vector<int> changed;
+  vector<bool> is_changed;
+};
+
+class FLP_LNS
+{ // large neighborhood search: at each iteration a region of the solution is destroyed (the clients of a
+  // few neighboring open warehouses, or a cluster of stores linked by incompatibilities), the stores are
+  // reinserted one by one at their cheapest feasible position, and the result is accepted with the simulated
+  // annealing criterion; destroy, repair and undo go through the journal of FLP_Output, so an iteration
+  // costs in proportion to the number of stores removed, and so does saving a new best state (only the
+  // assignments of the stores changed since the previous one are copied)
+public:
+  FLP_LNS(const FLP_Input& in, int max_removed, double start_temperature, double min_temperature);
+  CostType Run(FLP_Output& st, unsigned long iterations); // st is replaced by the best state found, whose cost is returned
+  unsigned long Accepted() const { return accepted; }
+  unsigned long FailedRepairs() const { return failed_repairs; }
+  void SetMonitor(function<bool(CostType)> m) { monitor = m; } // called with the best cost, stops the run if true
+private:
+  static const unsigned long CHECK_INTERVAL = 256;
+  void DestroyRegion(FLP_Output& st);
+  void DestroyCluster(FLP_Output& st);
+  void Remove(FLP_Output& st, int s);
+  bool Insert(FLP_Output& st, int s);
+  void Touch(const FLP_Output& st, int w); // records whether w is open before the changes
+  CostType Delta(const FLP_Output& st) const; // cost of the changes made since the destroy
+  const FLP_Input& in;
+  int max_removed;
+  double start_temperature, min_temperature;
+  vector<int> removed, region, candidates;
+  vector<bool> is_removed, in_region;
+  FLP_BestAssignments best;
+  vector<int> touched; // warehouses whose load has been changed
+  vector<bool> is_touched, was_open;
+  CostType supply_delta;
+  unsigned long accepted, failed_repairs;
+  function<bool(CostType)> monitor;
+};
+
+class FLP_ILS
+{ // iterated local search: each iteration kicks the current state with a chain of random Clopen moves 
+  // and brings it back to a local optimum by a descent on Change and Swap moves that applies the best 
+  // improving move of each queued store (the stores whose neighborhood the kick, or the descent itself,
+  // has modified: the clients of the warehouses involved, and the stores that prefer them and have an
+  // improving Change into them if they have been opened or have gained room); the 
+  // result is accepted if its cost is within threshold (a ratio) of the best one, otherwise the kick and
+  // the descent are undone through the journal of FLP_Output, so no copy of the state is made (the best
+  // state is saved from the stores in the journals of the accepted iterations)
+public:
+  FLP_ILS(const FLP_Input& in, const FLP_ChangeNeighborhoodExplorer& cnhe, const FLP_SwapNeighborhoodExplorer& snhe, 
+          const FLP_ClopenNeighborhoodExplorer& knhe, int kick_length, double threshold);
+  CostType Run(FLP_Output& st, unsigned long iterations); // st is replaced by the best state found, whose cost is returned
+  unsigned long Accepted() const { return accepted; }
+  unsigned long long DescentMoves() const { return descent_moves; }
+  void SetMonitor(function<bool(CostType)> m) { monitor = m; } // as in FLP_LNS
+private:
+  static const unsigned long CHECK_INTERVAL = 32;
+  CostType Kick(FLP_Output& st);
+  CostType Descend(FLP_Output& st);
+  bool BestChange(const FLP_Output& st, int s, FLP_Change& mv, CostType& delta) const;
+  bool BestSwap(const FLP_Output& st, int s, FLP_Swap& mv, CostType& delta) const;
+  void Enqueue(int s);
+  void Touch(const FLP_Output& st, int w); // before a move that involves w
+  void EnqueueTouched(const FLP_Output& st); // after the move
+  bool ImprovingChange(const FLP_Output& st, int s, int w) const; // w preferred by s
+  const FLP_Input& in;
+  const FLP_ChangeNeighborhoodExplorer& cnhe;
+  const FLP_SwapNeighborhoodExplorer& snhe;
+  const FLP_ClopenNeighborhoodExplorer& knhe;
+  int kick_length;
+  double threshold;
+  vector<int> queue; // stores whose moves must be (re)examined by the descent
+  vector<bool> queued;
+  struct Touched
+  {
+    int w, residual; // residual capacity before the move
+    bool open;
+  };
+  vector<Touched> touched;
+  FLP_BestAssignments best;
+  unsigned long accepted;
+  unsigned long long descent_moves;
+  function<bool(CostType)> monitor;
+};
+
+class FLP_ElitePool
+{ // the best distinct states found, at most capacity of them: the duplicates are detected in constant time 
+  // by the hash of the states (two different states with the same 64-bit hash are taken as equal)
+public:
+  FLP_ElitePool(unsigned capacity) : capacity(capacity) {}
+  bool Insert(const FLP_Output& st, CostType cost); // false if st is already in the pool, or too costly
+  bool Contains(const FLP_Output& st) const { return hashes.count(st.Hash()) > 0; }
+  unsigned Size() const { return states.size(); }
+  const FLP_Output& State(unsigned i) const { return states[i]; }
+  CostType Cost(unsigned i) const { return costs[i]; }
+  unsigned long Rejected() const { return rejected; } // duplicates
+private:
+  unsigned capacity;
+  vector<FLP_Output> states;
+  vector<CostType> costs;
+  unordered_set<unsigned long long> hashes;
+  unsigned long rejected = 0;
+};
+
+class FLP_HashedTabuSearch
+{ // tabu search on sampled Change and Swap moves, whose memory holds the hashes of the states visited in the
+  // last tenure iterations (instead of attributes of the moves): a move is tabu if it leads back to one of 
+  // them, unless it improves the best cost; the hash of the state reached by a move is computed by 
+  // FLP_Output::HashChange before making it. The local minima are collected in an elite pool, and the search
+  // restarts from one of them (at random) after restart iterations without improving the best cost
+public:
+  FLP_HashedTabuSearch(const FLP_Input& in, const FLP_ChangeNeighborhoodExplorer& cnhe, const FLP_SwapNeighborhoodExplorer& snhe, 
+                       double swap_rate, int samples, unsigned long tenure, unsigned elite, unsigned long restart);
+  CostType Run(FLP_Output& st, unsigned long iterations); // st is replaced by the best state found, whose cost is returned
+  const FLP_ElitePool& Elite() const { return pool; }
+  unsigned long TabuHits() const { return tabu_hits; } // moves discarded because tabu
+  unsigned long Restarts() const { return restarts; }
+  void SetMonitor(function<bool(CostType)> m) { monitor = m; } // as in FLP_LNS
+private:
+  static const unsigned long CHECK_INTERVAL = 256;
+  unsigned long long HashAfter(const FLP_Output& st, const FLP_Change& mv) const;
+  unsigned long long HashAfter(const FLP_Output& st, const FLP_Swap& mv) const;
+  Suppliers Replaced(const FLP_Output& st, int s, Position pos, int w, int q) const; // as in ReplaceSupplier
+  bool Tabu(unsigned long long h) const { return visited.count(h) > 0; }
+  void Visit(unsigned long long h);
+  const FLP_Input& in;
+  const FLP_ChangeNeighborhoodExplorer& cnhe;
+  const FLP_SwapNeighborhoodExplorer& snhe;
+  double swap_rate;
+  int samples;
+  unsigned long tenure, restart;
+  FLP_ElitePool pool;
+  FLP_BestAssignments best;
+  vector<unsigned long long> recent; // hashes of the last tenure states (circular)
+  unsigned long next;
+  unordered_map<unsigned long long,int> visited; // multiplicity of the hashes in recent
+  unsigned long tabu_hits, restarts;
+  function<bool(CostType)> monitor;
+};
+#endif
@@ -0,0 +1,563 @@
+// File FLP_Server.cc
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "FLP_Server.hh"
+#include "FLP_Flow.hh"
+
+static mutex easylocal_mutex; // see FLP_Solver::ThreadSafe
+
+unsigned long long FLP_InputCache::ContentHash(const string& content)
+{
+  unsigned long long h = 14695981039346656037ULL;
+  for (unsigned char c : content)
+    {
+      h ^= c;
+      h *= 1099511628211ULL;
+    }
+  return h;
+}
+
+unsigned long long FLP_InputCache::FileContentHash(const string& file_name)
+{ // the file is read and hashed outside the lock
+  struct stat info;
+  FileHash f;
+  if (stat(file_name.c_str(), &info) < 0)
+    throw invalid_argument("Cannot open input file " + file_name);
+  f.size = info.st_size;
+  f.modified = info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+  {
+    lock_guard<mutex> lock(m);
+    auto it = file_hashes.find(file_name);
+    if (it != file_hashes.end() && it->second.size == f.size && it->second.modified == f.modified)
+      return it->second.hash;
+  }
+  ifstream is(file_name.c_str(), ios::binary);
+  if (!is)
+    throw invalid_argument("Cannot open input file " + file_name);
+  stringstream content;
+  content << is.rdbuf();
+  f.hash = ContentHash(content.str());
+  lock_guard<mutex> lock(m);
+  file_hashes[file_name] = f;
+  return f.hash;
+}
+
+FLP_InputCache::Entry FLP_InputCache::Get(const string& file_name, double sqrt_ratio_preferred, int cost_diff_threshold,
+                                          bool sparse_costs, bool renumber, bool& hit)
+{ // the instance is parsed outside the lock: two concurrent misses on the same key load it twice
+  ostringstream os;
+  os << hex << FileContentHash(file_name) << dec << setprecision(17) << " " << sqrt_ratio_preferred << " "
+     << cost_diff_threshold << " " << sparse_costs << " " << renumber;
+  string key = os.str();
+  {
+    lock_guard<mutex> lock(m);
+    auto it = index.find(key);
+    if (it != index.end())
+      {
+        entries.splice(entries.begin(), entries, it->second);
+        hits++;
+        hit = true;
+        return it->second->second;
+      }
+  }
+  Entry e;
+  e.in = make_shared<const FLP_Input>(file_name, sqrt_ratio_preferred, cost_diff_threshold, sparse_costs, renumber);
+  FLP_FeasibilityOracle oracle(*e.in);
+  e.feasible = oracle.Feasible();
+  e.max_flow = oracle.MaxFlow();
+  e.demand = oracle.Demand();
+  lock_guard<mutex> lock(m);
+  misses++;
+  hit = false;
+  if (index.count(key) == 0)
+    {
+      entries.emplace_front(key, e);
+      index[key] = entries.begin();
+      while (entries.size() > capacity)
+        {
+          index.erase(entries.back().first);
+          entries.pop_back();
+        }
+    }
+  return e;
+}
+
+struct FLP_Server::Connection
+{ // the lines sent by different workers are never interleaved
+  Connection(int in_fd, int out_fd) : in_fd(in_fd), out_fd(out_fd) {}
+  ~Connection() { if (in_fd != STDIN_FILENO) close(in_fd); }
+  bool ReadLine(string& line);
+  void Send(const string& line);
+  int in_fd, out_fd;
+  mutex m;
+  string buffer;
+};
+
+bool FLP_Server::Connection::ReadLine(string& line)
+{
+  char chunk[4096];
+  size_t end;
+  ssize_t n;
+  while ((end = buffer.find('\n')) == string::npos)
+    {
+      n = read(in_fd, chunk, sizeof(chunk));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        { // the last line may lack the newline
+          line = buffer;
+          buffer.clear();
+          return line != "";
+        }
+      buffer.append(chunk, n);
+    }
+  line = buffer.substr(0, end);
+  buffer.erase(0, end + 1);
+  return true;
+}
+
+void FLP_Server::Connection::Send(const string& line)
+{ // a closed connection is ignored (SIGPIPE is ignored by Serve)
+  string data = line + "\n";
+  size_t done = 0;
+  ssize_t n;
+  lock_guard<mutex> lock(m);
+  while (done < data.size())
+    {
+      n = write(out_fd, data.data() + done, data.size() - done);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return;
+      done += n;
+    }
+}
+
+FLP_Server::FLP_Server(unsigned n, unsigned cache_size)
+  : cache(cache_size), running(0), quit(false), stopping(false), listener(-1)
+{
+  unsigned t;
+  if (n == 0)
+    n = max(1u, thread::hardware_concurrency());
+  for (t = 0; t < n; t++)
+    workers.push_back(thread(&FLP_Server::Work, this));
+}
+
+FLP_Server::~FLP_Server()
+{
+  {
+    lock_guard<mutex> lock(m);
+    quit = true;
+  }
+  available.notify_all();
+  for (thread& w : workers)
+    w.join();
+}
+
+void FLP_Server::Serve(const string& address)
+{
+  signal(SIGPIPE, SIG_IGN);
+  if (address == "-")
+    Read(make_shared<Connection>(STDIN_FILENO, STDOUT_FILENO));
+  else
+    {
+      list<pair<thread,shared_ptr<atomic<bool>>>> readers; // with their end flags
+      sockaddr_un sa;
+      int fd;
+      memset(&sa, 0, sizeof(sa));
+      sa.sun_family = AF_UNIX;
+      if (address.size() >= sizeof(sa.sun_path))
+        throw runtime_error("Socket path too long: " + address);
+      strcpy(sa.sun_path, address.c_str());
+      listener = socket(AF_UNIX, SOCK_STREAM, 0);
+      unlink(address.c_str());
+      if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) < 0 || listen(listener, 16) < 0)
+        throw runtime_error("Cannot listen on " + address + ": " + strerror(errno));
+      while (true)
+        {
+          fd = accept(listener, nullptr, nullptr);
+          if (fd < 0)
+            {
+              if (errno == EINTR && !stopping)
+                continue;
+              break;
+            }
+          for (auto it = readers.begin(); it != readers.end(); )
+            if (it->second->load())
+              {
+                it->first.join();
+                it = readers.erase(it);
+              }
+            else
+              ++it;
+          shared_ptr<Connection> connection = make_shared<Connection>(fd, fd);
+          shared_ptr<atomic<bool>> done = make_shared<atomic<bool>>(false);
+          {
+            lock_guard<mutex> lock(m);
+            connections.erase(remove_if(connections.begin(), connections.end(), 
+                                        [](const weak_ptr<Connection>& c) { return c.expired(); }), connections.end());
+            connections.push_back(connection);
+          }
+          readers.emplace_back(thread([this, connection, done]() { Read(connection); done->store(true); }), done);
+        }
+      for (pair<thread,shared_ptr<atomic<bool>>>& r : readers)
+        r.first.join();
+      close(listener);
+      unlink(address.c_str());
+    }
+  unique_lock<mutex> lock(m);
+  idle.wait(lock, [this] { return queue.empty() && running == 0; });
+}
+
+void FLP_Server::Shutdown()
+{ // the requests already queued are completed
+  lock_guard<mutex> lock(m);
+  stopping = true;
+  if (listener >= 0)
+    shutdown(listener, SHUT_RDWR);
+  for (weak_ptr<Connection>& c : connections)
+    if (shared_ptr<Connection> connection = c.lock())
+      shutdown(connection->in_fd, SHUT_RD);
+}
+
+void FLP_Server::Read(shared_ptr<Connection> connection)
+{
+  string line, error;
+  while (connection->ReadLine(line))
+    {
+      Request r;
+      r.connection = connection;
+      if (line.find_first_not_of(" \t\r") == string::npos)
+        continue;
+      if (!Parse(line, r.fields, r.runner_arguments, error))
+        {
+          connection->Send("{\"id\": " + Quote(r.fields["id"]) + ", \"error\": " + Quote(error) + "}");
+          continue;
+        }
+      const string& id = r.fields["id"];
+      if (r.fields.count("shutdown"))
+        {
+          Shutdown();
+          return;
+        }
+      if (r.fields.count("cancel"))
+        {
+          lock_guard<mutex> lock(m);
+          auto it = active.find(id);
+          if (it != active.end())
+            it->second->store(true);
+          connection->Send("{\"id\": " + Quote(id) + ", \"cancel\": \"" + (it != active.end() ? "sent" : "unknown request") + "\"}");
+          continue;
+        }
+      r.cancel = make_shared<atomic<bool>>(false);
+      {
+        lock_guard<mutex> lock(m);
+        if (stopping)
+          return;
+        active[id] = r.cancel;
+        queue.push_back(move(r));
+      }
+      available.notify_one();
+    }
+}
+
+void FLP_Server::Work()
+{
+  while (true)
+    {
+      Request r;
+      {
+        unique_lock<mutex> lock(m);
+        available.wait(lock, [this] { return quit || !queue.empty(); });
+        if (queue.empty())
+          return;
+        r = move(queue.front());
+        queue.pop_front();
+        running++;
+      }
+      Process(r);
+      {
+        lock_guard<mutex> lock(m);
+        auto it = active.find(r.fields["id"]);
+        if (it != active.end() && it->second == r.cancel)
+          active.erase(it);
+        running--;
+        r.connection.reset(); // the connection is closed by its last request
+      }
+      idle.notify_all();
+    }
+}
+
+void FLP_Server::Process(Request& r)
+{ // the fields of the request are those of FLP_Options, plus the instance and its preprocessing parameters
+  const string id = r.fields["id"];
+  auto reply = [&r, &id](const string& body) { r.connection->Send("{\"id\": " + Quote(id) + ", " + body + "}"); };
+  auto flag = [](const string& v)
+    {
+      if (v != "true" && v != "false")
+        throw invalid_argument("Boolean value expected instead of " + v);
+      return v == "true";
+    };
+  chrono::time_point<chrono::steady_clock> start = chrono::steady_clock::now(), last_progress = start;
+  FLP_Options options;
+  string instance, init_state;
+  double sqrt_ratio_preferred = 1.0, progress_interval = 1.0;
+  int cost_diff_threshold = 100;
+  bool sparse_costs = false, renumber = false, hit;
+  unique_ptr<FLP_Solver> solver;
+  try
+    {
+      for (const pair<const string,string>& f : r.fields)
+        {
+          const string& k = f.first;
+          const string& v = f.second;
+          if (k == "id") {}
+          else if (k == "instance") instance = v;
+          else if (k == "sqrt_ratio_preferred") sqrt_ratio_preferred = stod(v);
+          else if (k == "diff_threshold") cost_diff_threshold = stoi(v);
+          else if (k == "sparse_costs") sparse_costs = flag(v);
+          else if (k == "renumber") renumber = flag(v);
+          else if (k == "progress") progress_interval = stod(v);
+          else if (k == "method") options.method = v;
+          else if (k == "seed") { options.random_seed = false; options.seed = stoul(v); }
+          else if (k == "init_state_strategy") options.init_state_strategy = v;
+          else if (k == "init_state") init_state = v;
+          else if (k == "warm_temperature_ratio") options.warm_temperature_ratio = stod(v);
+          else if (k == "swap_rate") options.swap_rate = stod(v);
+          else if (k == "swap_bias") options.swap_bias = stod(v);
+          else if (k == "close_irate") options.close_rate = stod(v);
+          else if (k == "open_irate") options.open_rate = stod(v);
+          else if (k == "clopen_rate") options.clopen_rate = stod(v);
+          else if (k == "timeout_mode") options.timeout_mode = v;
+          else if (k == "timeout_factor") options.timeout_factor = stoi(v);
+          else if (k == "filtered_sampling") options.filtered_sampling = flag(v);
+          else if (k == "fused_delta") options.fused_delta = flag(v);
+          else if (k == "clopen_cache") options.clopen_cache = flag(v);
+          else if (k == "gap_threshold") options.gap_threshold = stod(v);
+          else if (k == "timeout") options.timeout = stod(v);
+          else if (k == "reduce") options.reduce = flag(v);
+          else if (k == "reduction_cost") options.reduction_cost = stoi(v);
+          else if (k == "polish") options.polish = flag(v);
+          else if (k == "polish_interval") options.polish_interval = stoul(v);
+          else if (k == "threads") options.threads = stoul(v);
+          else if (k == "starts") options.starts = stoi(v);
+          else if (k == "keep_starts") options.keep_starts = stoul(v);
+          else if (k == "random_starts") options.random_starts = stod(v);
+          else if (k == "init_time_limit") options.init_time_limit = stod(v);
+          else if (k == "LNS::iterations") options.lns_iterations = stoul(v);
+          else if (k == "LNS::max_removed") options.lns_max_removed = stoi(v);
+          else if (k == "LNS::start_temperature") options.lns_start_temperature = stod(v);
+          else if (k == "LNS::min_temperature") options.lns_min_temperature = stod(v);
+          else if (k == "ILS::iterations") options.ils_iterations = stoul(v);
+          else if (k == "ILS::kick_length") options.ils_kick_length = stoi(v);
+          else if (k == "ILS::threshold") options.ils_threshold = stod(v);
+          else if (k == "HTS::iterations") options.hts_iterations = stoul(v);
+          else if (k == "HTS::samples") options.hts_samples = stoi(v);
+          else if (k == "HTS::tenure") options.hts_tenure = stoul(v);
+          else if (k == "HTS::elite") options.hts_elite = stoul(v);
+          else if (k == "HTS::restart") options.hts_restart = stoul(v);
+          else
+            throw invalid_argument("Unknown field " + k);
+        }
+      options.runner_arguments = r.runner_arguments;
+      if (instance == "")
+        throw invalid_argument("The instance must be set");
+      if (r.cancel->load())
+        { // while queued
+          reply("\"error\": \"cancelled\"");
+          return;
+        }
+      FLP_InputCache::Entry entry = cache.Get(instance, sqrt_ratio_preferred, cost_diff_threshold, sparse_costs, renumber, hit);
+      if (!entry.feasible)
+        {
+          reply("\"error\": \"infeasible\", \"max_flow\": " + to_string(entry.max_flow) + ", \"demand\": " + to_string(entry.demand));
+          return;
+        }
+      options.check_capacity = false; // checked once per cached instance
+      // a progress line is sent when the best cost has changed, at most once every progress_interval seconds
+      CostType last_cost = -1;
+      function<void(CostType)> progress;
+      if (progress_interval > 0.0)
+        progress = [&](CostType cost)
+          {
+            chrono::time_point<chrono::steady_clock> now = chrono::steady_clock::now();
+            if (cost == last_cost || chrono::duration<double>(now - last_progress).count() < progress_interval)
+              return;
+            last_cost = cost;
+            last_progress = now;
+            ostringstream os;
+            os << setprecision(10) << "\"progress\": " << cost << ", \"elapsed\": " << chrono::duration<double>(now - start).count();
+            reply(os.str());
+          };
+      {
+        lock_guard<mutex> lock(easylocal_mutex);
+        if (r.cancel->load())
+          { // while waiting for the lock
+            reply("\"error\": \"cancelled\"");
+            return;
+          }
+        solver.reset(new FLP_Solver(*entry.in, options));
+      }
+      unique_lock<mutex> lock(easylocal_mutex, defer_lock);
+      if (!solver->ThreadSafe())
+        lock.lock();
+      FLP_Result result(*entry.in);
+      if (init_state != "")
+        {
+          istringstream is(init_state);
+          result = solver->WarmStart(is, progress, r.cancel.get());
+        }
+      else
+        result = solver->Solve(nullptr, progress, r.cancel.get());
+      if (lock.owns_lock())
+        lock.unlock();
+      if (result.error != "")
+        { // no initial state could be built
+          reply("\"error\": " + Quote(result.error) + ", " + result.error_details);
+          return;
+        }
+      ostringstream os;
+      result.output.PrettyPrint(os);
+      string solution = os.str();
+      os.str("");
+      os << setprecision(10)
+         << "\"cost\": " << result.cost << ", "
+         << "\"supply\": " << result.supply << ", "
+         << "\"opening\": " << result.opening << ", "
+         << "\"init_cost\": " << result.init_cost << ", "
+         << "\"init_time\": " << result.init_time << ", "
+         << "\"time\": " << result.time << ", "
+         << "\"consistent\": \"" << (result.consistent ? "yes" : "no") << "\", "
+         << "\"cancelled\": \"" << (result.cancelled ? "yes" : "no") << "\", "
+         << "\"cached\": \"" << (hit ? "yes" : "no") << "\", ";
+      if (init_state != "")
+        os << "\"repaired_stores\": " << result.repaired_stores << ", ";
+      os << "\"seed\": " << result.seed << ", "
+         << "\"solution\": " << Quote(solution);
+      reply(os.str());
+    }
+  catch (const exception& e)
+    {
+      reply("\"error\": " + Quote(e.what()));
+    }
+  lock_guard<mutex> lock(easylocal_mutex);
+  solver.reset();
+}
+
+bool FLP_Server::Parse(const string& line, map<string,string>& fields, vector<string>& runner_arguments, string& error)
+{ // a flat JSON object: the values are strings, numbers, booleans, or (runner_arguments only) arrays of strings
+  size_t i = 0;
+  string key, value;
+  auto skip = [&line, &i]() { while (i < line.size() && isspace(static_cast<unsigned char>(line[i]))) i++; };
+  auto read_string = [&line, &i](string& s)
+    {
+      s.clear();
+      if (i >= line.size() || line[i] != '"')
+        return false;
+      for (i++; i < line.size() && line[i] != '"'; i++)
+        if (line[i] == '\\' && i + 1 < line.size())
+          {
+            i++;
+            switch (line[i])
+              {
+              case 'n': s += '\n'; break;
+              case 't': s += '\t'; break;
+              case 'r': s += '\r'; break;
+              default: s += line[i]; // \uXXXX is not supported
+              }
+          }
+        else
+          s += line[i];
+      if (i >= line.size())
+        return false;
+      i++;
+      return true;
+    };
+  skip();
+  if (i >= line.size() || line[i++] != '{')
+    return error = "Object expected", false;
+  skip();
+  if (i < line.size() && line[i] == '}')
+    return true;
+  while (true)
+    {
+      skip();
+      if (!read_string(key))
+        return error = "Key expected", false;
+      skip();
+      if (i >= line.size() || line[i++] != ':')
+        return error = "Colon expected after " + key, false;
+      skip();
+      if (i < line.size() && line[i] == '"')
+        {
+          if (!read_string(value))
+            return error = "Unterminated string for " + key, false;
+          fields[key] = value;
+        }
+      else if (i < line.size() && line[i] == '[')
+        {
+          if (key != "runner_arguments")
+            return error = "Array not allowed for " + key, false;
+          i++;
+          skip();
+          while (i < line.size() && line[i] != ']')
+            {
+              if (!read_string(value))
+                return error = "String expected in " + key, false;
+              runner_arguments.push_back(value);
+              skip();
+              if (i < line.size() && line[i] == ',')
+                i++;
+              skip();
+            }
+          if (i >= line.size())
+            return error = "Unterminated array " + key, false;
+          i++;
+        }
+      else
+        { // number or literal
+          size_t begin = i;
+          while (i < line.size() && line[i] != ',' && line[i] != '}' && !isspace(static_cast<unsigned char>(line[i])))
+            i++;
+          if (i == begin)
+            return error = "Value expected for " + key, false;
+          fields[key] = line.substr(begin, i - begin);
+        }
+      skip();
+      if (i < line.size() && line[i] == ',')
+        i++;
+      else if (i < line.size() && line[i] == '}')
+        return true;
+      else
+        return error = "Comma or end of object expected after " + key, false;
+    }
+}
+
+string FLP_Server::Quote(const string& s)
+{
+  string q = "\"";
+  char code[8];
+  for (char c : s)
+    if (c == '"' || c == '\\')
+      q += string("\\") + c;
+    else if (c == '\n')
+      q += "\\n";
+    else if (static_cast<unsigned char>(c) < 0x20)
+      {
+        snprintf(code, sizeof(code), "\\u%04x", c);
+        q += code;
+      }
+    else
+      q += c;
+  return q + "\"";
+}
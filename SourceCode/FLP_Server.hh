@@ -0,0 +1,83 @@
+// File FLP_Server.hh
+#ifndef FLP_SERVER_HH
+#define FLP_SERVER_HH
+#include <list>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include "FLP_Solver.hh"
+
+class FLP_InputCache
+{ // the instances loaded most recently, at most capacity of them, keyed by the hash of the content of the
+  // file and by the preprocessing parameters; an instance evicted while a request uses it lives until
+  // the request ends (shared_ptr); the hash of a file is computed again only if its size or modification
+  // time has changed since the last request on it
+public:
+  struct Entry
+  {
+    shared_ptr<const FLP_Input> in;
+    bool feasible; // as checked by FLP_FeasibilityOracle
+    long long max_flow, demand;
+  };
+  FLP_InputCache(unsigned capacity) : capacity(capacity) {}
+  Entry Get(const string& file_name, double sqrt_ratio_preferred, int cost_diff_threshold, bool sparse_costs,
+            bool renumber, bool& hit); // throws invalid_argument if the file cannot be read
+  unsigned long Hits() const { return hits; }
+  unsigned long Misses() const { return misses; }
+private:
+  struct FileHash
+  {
+    long long size, modified; // modification time in nanoseconds
+    unsigned long long hash;
+  };
+  static unsigned long long ContentHash(const string& content); // FNV-1a
+  unsigned long long FileContentHash(const string& file_name);
+  unsigned capacity;
+  mutex m;
+  unordered_map<string,FileHash> file_hashes; // by file name
+  list<pair<string,Entry>> entries; // most recently used first
+  unordered_map<string,list<pair<string,Entry>>::iterator> index;
+  unsigned long hits = 0, misses = 0;
+};
+
+class FLP_Server
+{ // solve requests, one JSON object per line, read from stdin or from the connections to a Unix domain
+  // socket; the requests are queued and run by a pool of workers, each one answering on the connection
+  // of the request with progress lines and a final line with the solution (see README.md for the fields);
+  // the methods that are not FLP_Solver::ThreadSafe, CSKSA (the default) included, hold a global lock
+  // for the whole Solve, so only requests on LNS, ILS, HTS, KPSD, and CPSD run concurrently
+public:
+  FLP_Server(unsigned workers, unsigned cache_size); // workers: 0 = as many as the hardware threads
+  ~FLP_Server();
+  // "-" = stdin/stdout, otherwise the path of the socket; throws runtime_error if the socket cannot be set up
+  void Serve(const string& address);
+private:
+  struct Connection;
+  struct Request
+  {
+    shared_ptr<Connection> connection;
+    map<string,string> fields;
+    vector<string> runner_arguments;
+    shared_ptr<atomic<bool>> cancel;
+  };
+  void Read(shared_ptr<Connection> connection); // until the end of the input, or a shutdown request
+  void Work();
+  void Process(Request& r);
+  void Shutdown();
+  static bool Parse(const string& line, map<string,string>& fields, vector<string>& runner_arguments, string& error);
+  static string Quote(const string& s); // as a JSON string
+  FLP_InputCache cache;
+  vector<thread> workers;
+  mutex m;
+  condition_variable available, idle;
+  deque<Request> queue;
+  unordered_map<string,shared_ptr<atomic<bool>>> active; // cancellation flags of the requests, by id
+  vector<weak_ptr<Connection>> connections; // to stop their readers at shutdown (the closed ones are dropped at each accept)
+  unsigned running; // requests being processed
+  bool quit, stopping;
+  int listener; // socket (-1 with stdin/stdout)
+};
+#endif
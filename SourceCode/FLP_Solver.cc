@@ -0,0 +1,560 @@
+// File FLP_Solver.cc
+#include <chrono>
+#include <cmath>
+#include "FLP_Solver.hh"
+#include "FLP_Helpers.hh"
+#include "FLP_Runners.hh"
+#include "FLP_Bounds.hh"
+#include "FLP_Flow.hh"
+#include "FLP_Parallel.hh"
+#include "FLP_Search.hh"
+
+using namespace EasyLocal::Debug;
+
+typedef DefaultCostStructure<CostType> FLP_CostStructure;
+typedef SetUnionNeighborhoodExplorer<FLP_Input, FLP_Output, FLP_CostStructure, FLP_ChangeNeighborhoodExplorer,
+                                     FLP_SwapNeighborhoodExplorer> FLP_ChangeSwapNeighborhoodExplorer;
+typedef SetUnionNeighborhoodExplorer<FLP_Input, FLP_Output, FLP_CostStructure, FLP_ChangeNeighborhoodExplorer,
+                                     FLP_SwapNeighborhoodExplorer, FLP_ClopenNeighborhoodExplorer> FLP_ChangeSwapClopenNeighborhoodExplorer;
+
+struct FLP_Engine
+{ // all the runners are monitored, so that any of them can be cancelled
+  FLP_Engine(const FLP_Input& in, const FLP_Options& o);
+  FLP_Supply cc1;
+  FLP_Opening cc2;
+  FLP_ChangeDeltaSupply dc_cc1;
+  FLP_ChangeDeltaOpening dc_cc2;
+  FLP_SwapDeltaSupply ds_cc1;
+  // FLP_SwapDeltaOpening ds_cc2;
+  FLP_ClopenDeltaSupply dk_cc1;
+  FLP_ClopenDeltaOpening dk_cc2;
+  // fused alternative: a single component, whose delta costs compute supply and opening together
+  FLP_Total cc;
+  FLP_FusedDelta<FLP_Change> dc_cc;
+  FLP_FusedDelta<FLP_Swap> ds_cc;
+  FLP_FusedDelta<FLP_Clopen> dk_cc;
+  // helpers
+  FLP_SolutionManager sm;
+  FLP_ChangeNeighborhoodExplorer cnhe;
+  FLP_SwapNeighborhoodExplorer snhe;
+  FLP_ClopenNeighborhoodExplorer knhe;
+  // neighborhood compositions
+  FLP_ChangeSwapNeighborhoodExplorer csnhe;
+  FLP_ChangeSwapClopenNeighborhoodExplorer csknhe;
+  // runners
+  FLP_MonitoredRunner<HillClimbing<FLP_Input, FLP_Output, FLP_Change, FLP_CostStructure>> chc;
+  FLP_MonitoredRunner<SteepestDescent<FLP_Input, FLP_Output, FLP_Change, FLP_CostStructure>> csd;
+  FLP_MonitoredRunner<SteepestDescent<FLP_Input, FLP_Output, FLP_Clopen, FLP_CostStructure>> ksd;
+  FLP_MonitoredRunner<SteepestDescent<FLP_Input, FLP_Output, FLP_ChangeSwapNeighborhoodExplorer::MoveType, FLP_CostStructure>> cssd;
+  FLP_AnnealingRunner<SimulatedAnnealing<FLP_Input, FLP_Output, FLP_Change, FLP_CostStructure>> csa;
+  FLP_MonitoredRunner<TabuSearch<FLP_Input, FLP_Output, FLP_Change, FLP_CostStructure>> cts;
+  FLP_AnnealingRunner<SimulatedAnnealing<FLP_Input, FLP_Output, FLP_ChangeSwapNeighborhoodExplorer::MoveType, FLP_CostStructure>> cssa;
+  FLP_AnnealingRunner<SimulatedAnnealing<FLP_Input, FLP_Output, FLP_ChangeSwapClopenNeighborhoodExplorer::MoveType, FLP_CostStructure>> csksa;
+  FLP_MonitoredRunner<TabuSearch<FLP_Input, FLP_Output, FLP_ChangeSwapClopenNeighborhoodExplorer::MoveType, FLP_CostStructure>> cskts;
+  FLP_AnnealingRunner<SimulatedAnnealingTimeBased<FLP_Input, FLP_Output, FLP_ChangeSwapClopenNeighborhoodExplorer::MoveType, FLP_CostStructure>> csksa_tb;
+  // tester
+  Tester<FLP_Input, FLP_Output, FLP_CostStructure> tester;
+  MoveTester<FLP_Input, FLP_Output, FLP_Change, FLP_CostStructure> change_move_test;
+  MoveTester<FLP_Input, FLP_Output, FLP_Swap, FLP_CostStructure> swap_move_test;
+  MoveTester<FLP_Input, FLP_Output, FLP_Clopen, FLP_CostStructure> k_move_test;
+  MoveTester<FLP_Input, FLP_Output, FLP_ChangeSwapNeighborhoodExplorer::MoveType, FLP_CostStructure> cs_move_test;
+  MoveTester<FLP_Input, FLP_Output, FLP_ChangeSwapClopenNeighborhoodExplorer::MoveType, FLP_CostStructure> csk_move_test;
+  SimpleLocalSearch<FLP_Input, FLP_Output, FLP_CostStructure> solver;
+};
+
+FLP_Engine::FLP_Engine(const FLP_Input& in, const FLP_Options& o)
+  : cc1(in, 1, false), cc2(in, 1, false), dc_cc1(in, cc1), dc_cc2(in, cc2), ds_cc1(in, cc1), dk_cc1(in, cc1), dk_cc2(in, cc2),
+    cc(in, 1, false, cc1, cc2), dc_cc(in, cc), ds_cc(in, cc), dk_cc(in, cc),
+    sm(in, o.check_capacity || o.reduce), cnhe(in, sm, o.filtered_sampling), snhe(in, sm, o.swap_bias, o.filtered_sampling),
+    knhe(in, sm, o.close_rate, o.open_rate, o.clopen_cache),
+    csnhe(in, sm, "Change/Swap", cnhe, snhe, {1 - o.swap_rate, o.swap_rate}),
+    csknhe(in, sm, "Change/Swap/Clopen", cnhe, snhe, knhe, {1 - o.swap_rate - o.clopen_rate, o.swap_rate, o.clopen_rate}),
+    chc(in, sm, cnhe, "CHC"), csd(in, sm, cnhe, "CSD"), ksd(in, sm, knhe, "KSD"), cssd(in, sm, csnhe, "CSSD"),
+    csa(in, sm, cnhe, "CSA"), cts(in, sm, cnhe, "CTS", FLP_Change::Inverse), cssa(in, sm, csnhe, "CSSA"),
+    csksa(in, sm, csknhe, "CSKSA"), cskts(in, sm, csknhe, "CSKTS"), csksa_tb(in, sm, csknhe, "CSKSAtb"),
+    tester(in, sm), change_move_test(in, sm, cnhe, "FLP_Change move", tester),
+    swap_move_test(in, sm, snhe, "FLP_Swap move", tester), k_move_test(in, sm, knhe, "FLP_Clopen move", tester),
+    cs_move_test(in, sm, csnhe, "Change/Swap move", tester), csk_move_test(in, sm, csknhe, "Change/Swap/Clopen move", tester),
+    solver(in, sm, "FLP solver")
+{
+  // All cost components must be added to the state manager
+  // All delta cost components must be added to the neighborhood explorer
+  if (o.fused_delta)
+    { // supply and opening are still computed separately for the report
+      sm.AddCostComponent(cc);
+      cnhe.AddDeltaCostComponent(dc_cc);
+      snhe.AddDeltaCostComponent(ds_cc);
+      knhe.AddDeltaCostComponent(dk_cc);
+    }
+  else
+    {
+      sm.AddCostComponent(cc1);
+      sm.AddCostComponent(cc2);
+
+      cnhe.AddDeltaCostComponent(dc_cc1);
+      cnhe.AddDeltaCostComponent(dc_cc2);
+
+      snhe.AddDeltaCostComponent(ds_cc1);
+      // snhe.AddDeltaCostComponent(ds_cc2);
+
+      knhe.AddDeltaCostComponent(dk_cc1);
+      knhe.AddDeltaCostComponent(dk_cc2);
+    }
+}
+
+static const double REDUCTION_TOLERANCE = 1e-9; // relative
+
+FLP_Solver::FLP_Solver(const FLP_Input& my_in, const FLP_Options& my_options)
+  : in(my_in), options(my_options), reduction_cost(-1), reduction_time(0.0), fixed_warehouses(0), excluded_warehouses(0),
+    removed_preferred_pairs(0), removed_neighbor_pairs(0)
+{
+  int w;
+  const string methods[] = {"CSA", "CSSA", "CSKSA", "CSKSAtb", "CHC", "CSD", "KSD", "KPSD", "CPSD", "LNS", "ILS", "HTS"};
+  if (find(begin(methods), end(methods), options.method) == end(methods))
+    throw invalid_argument("Unknown method " + options.method);
+  if (options.init_state_strategy != "greedy" && options.init_state_strategy != "random")
+    throw invalid_argument("Unknown initial state strategy");
+  if (!options.random_seed)
+    Random::SetSeed(options.seed);
+  seed = Random::GetSeed();
+  FLP_Random::SetSeed(seed); // the generator of the calling thread (the pools receive the seed explicitly)
+  if (options.checkpoint_file != "" && (options.keep_starts > 1
+      || (options.method != "CSA" && options.method != "CSSA" && options.method != "CSKSA" && options.method != "CSKSAtb")))
+    throw invalid_argument("Checkpoints are saved only by CSA, CSSA, CSKSA, and CSKSAtb, with one kept start");
+
+  // reduction: warehouses and preferred pairs that cannot be part of a solution better than a known one
+  // (greedy by default) are removed from a copy of the instance, before the explorers are built on it
+  chrono::time_point<chrono::system_clock> reduction_start = chrono::system_clock::now();
+  CostType upper_bound = options.reduction_cost;
+  if (options.reduce && upper_bound < 0)
+    try
+      {
+        FLP_SolutionManager sm(in, options.check_capacity);
+        FLP_Output greedy(in);
+        sm.GreedyState(greedy);
+        upper_bound = greedy.ComputeCost();
+      }
+    catch (const FLP_ConstructionError&)
+      { // no solution is known: the instance is not reduced, and the construction of the run reports the failure
+        options.reduce = false;
+      }
+  if (options.reduce)
+    {
+      reduction_cost = upper_bound;
+      reduced.reset(new FLP_Input(in));
+    }
+  bound.reset(new FLP_LagrangianBound(Input()));
+  if (options.reduce)
+    {
+      vector<bool> fixed_open(in.Warehouses(),false);
+      vector<bool> was_preferred(in.Warehouses());
+      FLP_LagrangianBound& b = *bound;
+      // the bounds are sums of many doubles: a bound must exceed the known cost by a margin to prune
+      double threshold = upper_bound + REDUCTION_TOLERANCE * max(1.0, fabs(static_cast<double>(upper_bound)));
+      b.Run(upper_bound);
+      b.ComputeReducedCosts();
+      for (w = 0; w < in.Warehouses(); w++)
+        {
+          was_preferred[w] = in.PreferredClients(w) > 0;
+          fixed_open[w] = b.CloseBound(w) >= threshold;
+          if (fixed_open[w])
+            fixed_warehouses++;
+        }
+      reduced->Reduce([&b, threshold](int s, int w) { return b.ArcBound(s,w) >= threshold; }, fixed_open);
+      for (w = 0; w < in.Warehouses(); w++)
+        if (was_preferred[w] && reduced->PreferredClients(w) == 0)
+          excluded_warehouses++;
+      removed_preferred_pairs = in.PreferredPairs() - reduced->PreferredPairs();
+      removed_neighbor_pairs = in.NeighborWarehousePairs() - reduced->NeighborWarehousePairs();
+      reduction_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - reduction_start).count()/1000.0;
+    }
+  engine.reset(new FLP_Engine(Input(), options));
+
+  if (!options.runner_arguments.empty())
+    { // parsed as a command line (all the other parameter boxes are left unchanged)
+      vector<const char*> arguments(1, "flp");
+      for (const string& a : options.runner_arguments)
+        arguments.push_back(a.c_str());
+      if (!CommandLineParameters::Parse(arguments.size(), arguments.data(), true, true))
+        throw invalid_argument("Invalid runner arguments");
+    }
+}
+
+FLP_Solver::~FLP_Solver()
+{}
+
+bool FLP_Solver::ThreadSafe() const
+{
+  return options.method == "LNS" || options.method == "ILS" || options.method == "HTS"
+    || options.method == "KPSD" || options.method == "CPSD";
+}
+
+bool FLP_Solver::ParseArguments(int argc, const char* argv[])
+{
+  return CommandLineParameters::Parse(argc, argv, true, false);
+}
+
+void FLP_Solver::RunTester(const string& init_state)
+{
+  if (init_state != "")
+    engine->tester.RunMainMenu(init_state);
+  else
+    engine->tester.RunMainMenu();
+}
+
+FLP_Result FLP_Solver::Solve(const FLP_Output* warm_start, function<void(CostType)> progress, const atomic<bool>* cancel)
+{ // the result is bound to the instance passed by the caller (reduced or not, the solutions are the same)
+  FLP_Engine& e = *engine;
+  const FLP_Input& sin = Input();
+  const string& method = options.method;
+  FLP_Result result(in);
+  FLP_Output init(sin), out(sin);
+  vector<FLP_Output> initial_states; // the others kept by the multi-start construction, by increasing cost
+  chrono::time_point<chrono::system_clock> start = chrono::system_clock::now();
+  try
+    {
+      if (warm_start != nullptr)
+        init = *warm_start;
+      else if (options.starts > 1)
+        {
+          FLP_ThreadPool pool(options.threads);
+          FLP_MultiStart multistart(sin, pool, options.init_state_strategy == "random" ? 1.0 : options.random_starts,
+                                    options.init_time_limit, seed);
+          e.sm.CheckCapacity();
+          multistart.Run(options.starts, max(1u, options.keep_starts));
+          init = multistart.State(0);
+          for (unsigned i = 1; i < multistart.Kept(); i++)
+            initial_states.push_back(multistart.State(i));
+          result.constructions = multistart.Constructions();
+        }
+      else if (options.init_state_strategy == "greedy")
+        e.sm.GreedyState(init);
+      else
+        e.sm.RandomState(init);
+    }
+  catch (const FLP_ConstructionError& error)
+    { // no initial state, and no solution: the result reports the error only
+      result.error = error.Reason();
+      result.error_details = error.Details();
+      result.seed = seed;
+      return result;
+    }
+  result.init_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count()/1000.0;
+  result.kept_starts = initial_states.size() + 1;
+
+  double allowed_running_time = 0.0;
+  if (method == "CSKSAtb")
+    {
+      if (resuming != nullptr) // what was left at the checkpoint
+        allowed_running_time = resuming->remaining;
+      else if (options.timeout_mode == "linear")
+        allowed_running_time = (sin.Warehouses() - result.init_time)/(initial_states.size() + 1);
+      else
+        allowed_running_time = (options.timeout_factor*sqrt(sin.Warehouses()) - result.init_time)/(initial_states.size() + 1);
+      e.csksa_tb.SetParameter("allowed_running_time", allowed_running_time);
+    }
+
+  // the monitor reports the best cost, and stops the search if cancelled, at the timeout, or if the gap from
+  // the bound (computed in background) is small enough
+  function<bool(CostType)> monitor;
+  if (progress || cancel != nullptr || options.gap_threshold >= 0.0 || options.timeout > 0.0)
+    {
+      FLP_LagrangianBound& b = *bound;
+      double threshold = options.gap_threshold;
+      bool& cancelled = result.cancelled;
+      bool timed = options.timeout > 0.0;
+      chrono::time_point<chrono::system_clock> deadline = chrono::system_clock::now()
+        + chrono::duration_cast<chrono::system_clock::duration>(chrono::duration<double>(options.timeout));
+      monitor = [&b, threshold, progress, cancel, &cancelled, timed, deadline](CostType best_cost)
+        {
+          if (progress)
+            progress(best_cost);
+          if (cancel != nullptr && cancel->load())
+            return cancelled = true;
+          if (timed && chrono::system_clock::now() >= deadline)
+            return true;
+          if (threshold < 0.0)
+            return false;
+          b.SetUpperBound(best_cost);
+          return best_cost - b.Bound() <= threshold * best_cost;
+        };
+      if (threshold >= 0.0 && !options.reduce) // otherwise already computed
+        b.Start(init.ComputeCost());
+    }
+  e.chc.SetMonitor(monitor);
+  e.csd.SetMonitor(monitor);
+  e.ksd.SetMonitor(monitor);
+  e.cssd.SetMonitor(monitor);
+  e.csa.SetMonitor(monitor);
+  e.cts.SetMonitor(monitor);
+  e.cssa.SetMonitor(monitor);
+  e.csksa.SetMonitor(monitor);
+  e.cskts.SetMonitor(monitor);
+  e.csksa_tb.SetMonitor(monitor);
+
+  FLP_SupplyPolisher polisher(sin);
+  function<bool(FLP_Output&)> action;
+  if (options.polish_interval > 0)
+    action = [&polisher](FLP_Output& st) { return polisher.Polish(st); };
+  e.csksa.SetPeriodicAction(action, options.polish_interval);
+  e.csksa_tb.SetPeriodicAction(action, options.polish_interval);
+
+  // a warm start is already close to a local optimum: the annealing starts cooler
+  double temperature_ratio = warm_start != nullptr ? options.warm_temperature_ratio : 1.0;
+  e.csa.SetTemperatureRatio(temperature_ratio);
+  e.cssa.SetTemperatureRatio(temperature_ratio);
+  e.csksa.SetTemperatureRatio(temperature_ratio);
+  e.csksa_tb.SetTemperatureRatio(temperature_ratio);
+
+  // the checkpoints of the annealings are completed with what the runner does not know, and written in background
+  unique_ptr<FLP_CheckpointWriter> writer;
+  function<void(FLP_Checkpoint&)> save;
+  if (options.checkpoint_file != "")
+    {
+      writer.reset(new FLP_CheckpointWriter(options.checkpoint_file));
+      FLP_CheckpointWriter& w = *writer;
+      unsigned run_seed = seed;
+      unsigned long long instance = in.Fingerprint();
+      const FLP_Input& original = in;
+      const FLP_Options& o = options;
+      int bound_cost = reduction_cost;
+      save = [&w, &method, run_seed, instance, &original, &o, bound_cost, allowed_running_time](FLP_Checkpoint& c)
+        {
+          c.method = method;
+          c.seed = run_seed;
+          c.instance = instance;
+          c.sqrt_ratio_preferred = original.SqrtRatioPreferred();
+          c.cost_diff_threshold = original.CostDiffThreshold();
+          c.renumber = original.Renumbered();
+          c.reduce = o.reduce;
+          c.reduction_cost = bound_cost; // the greedy cost depends on the seed: the resumed run needs this one
+          c.remaining = allowed_running_time - c.elapsed;
+          w.Submit(c.Encode());
+        };
+    }
+  e.csa.SetCheckpoint(save, options.checkpoint_interval, seed);
+  e.cssa.SetCheckpoint(save, options.checkpoint_interval, seed);
+  e.csksa.SetCheckpoint(save, options.checkpoint_interval, seed);
+  e.csksa_tb.SetCheckpoint(save, options.checkpoint_interval, seed);
+  e.csa.SetResume(resuming, resuming_best);
+  e.cssa.SetResume(resuming, resuming_best);
+  e.csksa.SetResume(resuming, resuming_best);
+  e.csksa_tb.SetResume(resuming, resuming_best);
+
+  CostType cost;
+  double running_time;
+  if (method == "KPSD")
+    { // steepest descent on Clopen moves, with the neighborhood explored in parallel
+      FLP_ThreadPool pool(options.threads);
+      FLP_ParallelClopenSearch search(sin, e.knhe, pool);
+      start = chrono::system_clock::now();
+      out = init;
+      result.moves = search.Descend(out);
+      running_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count()/1000.0;
+      cost = e.sm.CostFunctionComponents(out).total;
+    }
+  else if (method == "CPSD")
+    { // steepest descent on Change moves, with batches of independent moves
+      FLP_ThreadPool pool(options.threads);
+      FLP_ParallelChangeSearch search(sin, e.cnhe, pool);
+      start = chrono::system_clock::now();
+      out = init;
+      result.moves = search.Descend(out);
+      running_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count()/1000.0;
+      cost = e.sm.CostFunctionComponents(out).total;
+      result.sweeps = search.Sweeps();
+    }
+  else if (method == "LNS")
+    {
+      FLP_LNS lns(sin, options.lns_max_removed, max(options.lns_start_temperature * temperature_ratio, options.lns_min_temperature),
+                  options.lns_min_temperature);
+      lns.SetMonitor(monitor);
+      start = chrono::system_clock::now();
+      out = init;
+      cost = lns.Run(out, options.lns_iterations);
+      running_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count()/1000.0;
+      result.moves = lns.Accepted();
+    }
+  else if (method == "ILS")
+    {
+      FLP_ILS ils(sin, e.cnhe, e.snhe, e.knhe, options.ils_kick_length, options.ils_threshold);
+      ils.SetMonitor(monitor);
+      start = chrono::system_clock::now();
+      out = init;
+      cost = ils.Run(out, options.ils_iterations);
+      running_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count()/1000.0;
+      result.moves = ils.Accepted();
+    }
+  else if (method == "HTS")
+    {
+      FLP_HashedTabuSearch hts(sin, e.cnhe, e.snhe, options.swap_rate, options.hts_samples, options.hts_tenure,
+                               options.hts_elite, options.hts_restart);
+      hts.SetMonitor(monitor);
+      start = chrono::system_clock::now();
+      out = init;
+      cost = hts.Run(out, options.hts_iterations);
+      running_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count()/1000.0;
+      result.tabu_hits = hts.TabuHits();
+      result.elite_size = hts.Elite().Size();
+      result.elite_duplicates = hts.Elite().Rejected();
+      result.restarts = hts.Restarts();
+    }
+  else
+    {
+      if (method == "CSA")
+        e.solver.SetRunner(e.csa);
+      else if (method == "CSSA")
+        e.solver.SetRunner(e.cssa);
+      else if (method == "CSKSAtb")
+        e.solver.SetRunner(e.csksa_tb);
+      else if (method == "CSKSA")
+        e.solver.SetRunner(e.csksa);
+      else if (method == "CHC")
+        e.solver.SetRunner(e.chc);
+      else if (method == "CSD")
+        e.solver.SetRunner(e.csd);
+      else // KSD
+        e.solver.SetRunner(e.ksd);
+      auto r = e.solver.Resolve(init);
+      out = r.output;
+      cost = r.cost.total;
+      running_time = r.running_time;
+      for (const FLP_Output& initial_state : initial_states)
+        { // multi-start: the time budget of CSKSAtb is split among the runs
+          if (result.cancelled)
+            break;
+          r = e.solver.Resolve(initial_state);
+          if (r.cost.total < cost)
+            {
+              out = r.output;
+              cost = r.cost.total;
+            }
+          running_time += r.running_time;
+        }
+      if (method == "CSKSAtb")
+        result.iterations = e.csksa_tb.Evaluations() + (resuming != nullptr ? resuming->evaluations : 0);
+      if (resuming != nullptr)
+        running_time += resuming->elapsed;
+    }
+  bound->Stop();
+  if (writer)
+    {
+      writer->Finish();
+      result.checkpoints = writer->Written();
+    }
+  if (options.polish && polisher.Polish(out))
+    cost = e.sm.CostFunctionComponents(out).total;
+
+  result.output = out;
+  result.init = init;
+  result.cost = cost;
+  result.supply = e.cc1.ComputeCost(out);
+  result.opening = e.cc2.ComputeCost(out);
+  result.init_cost = init.ComputeCost();
+  result.init_supply = e.cc1.ComputeCost(init);
+  result.init_opening = e.cc2.ComputeCost(init);
+  result.time = running_time;
+  result.consistent = e.sm.CheckConsistency(out);
+  result.seed = seed;
+  result.change_wasted_draws = e.cnhe.Sampling().WastedDrawsPerSample();
+  result.swap_wasted_draws = e.snhe.Sampling().WastedDrawsPerSample();
+  result.lower_bound = bound->Bound();
+  result.reduction_time = reduction_time;
+  result.fixed_warehouses = fixed_warehouses;
+  result.excluded_warehouses = excluded_warehouses;
+  result.removed_preferred_pairs = removed_preferred_pairs;
+  result.removed_neighbor_pairs = removed_neighbor_pairs;
+  result.clopen_cache_lookups = e.knhe.Cache().Lookups();
+  result.clopen_cache_hit_rate = e.knhe.Cache().HitRate();
+  result.polish_calls = polisher.Calls();
+  result.polish_improvements = polisher.Improvements();
+  result.polish_time = polisher.Time();
+  result.greedy_repairs = e.sm.GreedyRepairs();
+  result.greedy_restarts = e.sm.GreedyRestarts();
+  return result;
+}
+
+FLP_Result FLP_Solver::Replan(const FLP_Output& previous, function<void(CostType)> progress, const atomic<bool>* cancel)
+{ // the search is cut to the budget of a replanning round, the other options are kept
+  FLP_Output st(Input());
+  double timeout = options.timeout;
+  FLP_Result result(in);
+  st = previous;
+  if (options.replan_timeout > 0.0 && (options.timeout <= 0.0 || options.replan_timeout < options.timeout))
+    options.timeout = options.replan_timeout;
+  try
+    {
+      result = SolveRepaired(st, true, progress, cancel);
+    }
+  catch (...)
+    {
+      options.timeout = timeout;
+      throw;
+    }
+  options.timeout = timeout;
+  return result;
+}
+
+FLP_Result FLP_Solver::WarmStart(istream& is, function<void(CostType)> progress, const atomic<bool>* cancel)
+{ // the counters of the state are built by the reading, no rebuild is needed
+  FLP_Output st(Input());
+  is >> st;
+  return SolveRepaired(st, false, progress, cancel);
+}
+
+FLP_Result FLP_Solver::SolveRepaired(FLP_Output& st, bool rebuild, function<void(CostType)> progress, const atomic<bool>* cancel)
+{ // the repair is part of the initial time
+  chrono::time_point<chrono::system_clock> start = chrono::system_clock::now();
+  int repaired = engine->sm.RepairState(st, rebuild);
+  double repair_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count()/1000.0;
+  FLP_Result result = Solve(repaired >= 0 ? &st : nullptr, progress, cancel);
+  result.init_time += repair_time;
+  result.repaired_stores = repaired;
+  return result;
+}
+
+FLP_Result FLP_Solver::Resume(const FLP_Checkpoint& checkpoint, function<void(CostType)> progress, const atomic<bool>* cancel)
+{ // the rebuild of the states is part of the initial time
+  if (checkpoint.method != options.method)
+    throw invalid_argument("The checkpoint is for method " + checkpoint.method);
+  if (checkpoint.instance != in.Fingerprint())
+    throw invalid_argument("The checkpoint is for another instance");
+  if (checkpoint.sqrt_ratio_preferred != in.SqrtRatioPreferred() || checkpoint.cost_diff_threshold != in.CostDiffThreshold()
+      || checkpoint.renumber != in.Renumbered() || checkpoint.reduce != options.reduce
+      || (options.reduce && checkpoint.reduction_cost != reduction_cost))
+    throw invalid_argument("The checkpoint is for other preprocessing options (sqrt_ratio_preferred " 
+                           + to_string(checkpoint.sqrt_ratio_preferred) + ", diff_threshold " + to_string(checkpoint.cost_diff_threshold)
+                           + ", renumber " + to_string(checkpoint.renumber) + ", reduce " + to_string(checkpoint.reduce) 
+                           + ", reduction_cost " + to_string(checkpoint.reduction_cost) + ")");
+  chrono::time_point<chrono::system_clock> start = chrono::system_clock::now();
+  FLP_Output current(Input()), best(Input());
+  checkpoint.Restore(Input(), current, best);
+  double restore_time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count()/1000.0;
+  seed = checkpoint.seed;
+  Random::SetSeed(seed);
+  FLP_Random::SetSeed(seed);
+  resuming = &checkpoint;
+  resuming_best = &best;
+  FLP_Result result(in);
+  try
+    {
+      result = Solve(&current, progress, cancel);
+    }
+  catch (...)
+    { // best is local, the solver must not keep it
+      resuming = nullptr;
+      resuming_best = nullptr;
+      throw;
+    }
+  resuming = nullptr;
+  resuming_best = nullptr;
+  result.init_time += restore_time;
+  return result;
+}
+
+FLP_Result FLP_Solve(const FLP_Input& in, const FLP_Options& options, const FLP_Output* warm_start,
+                     function<void(CostType)> progress, const atomic<bool>* cancel)
+{
+  FLP_Solver solver(in, options);
+  return solver.Solve(warm_start, progress, cancel);
+}
@@ -0,0 +1,136 @@
+// File FLP_Solver.hh
+#ifndef FLP_SOLVER_HH
+#define FLP_SOLVER_HH
+#include <string>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include "FLP_Output.hh"
+
+// the solver as a library: the components of the search (cost components, explorers, runners) are built
+// by FLP_Solver on an instance already in memory, and each call of Solve returns the result, instead of
+// printing it; the command line program (FLP_Main.cc) is a thin layer on top of it
+
+struct FLP_Options
+{ // the options of the main, LNS, ILS, and HTS boxes of the command line, with the same defaults
+  string method = "CSKSA"; // CSA, CSSA, CSKSA, CSKSAtb, CHC, CSD, KSD, KPSD, CPSD, LNS, ILS, or HTS
+  bool random_seed = true; // otherwise seed is used
+  unsigned seed = 0;
+  string init_state_strategy = "greedy"; // or random
+  double swap_rate = 0.19, swap_bias = 0.44, close_rate = 0.33, open_rate = 0.33, clopen_rate = 0.1;
+  string timeout_mode = "sqrt"; // or linear (CSKSAtb only)
+  int timeout_factor = 10;
+  bool filtered_sampling = false, fused_delta = false, clopen_cache = false;
+  double gap_threshold = -1.0; // < 0: no Lagrangian bound
+  double timeout = 0.0; // seconds of search after the initial state (0: no limit; all methods but KPSD and CPSD)
+  double replan_timeout = 10.0; // the timeout of Replan, if lower (0: as Solve)
+  bool reduce = false;
+  int reduction_cost = -1; // < 0: the greedy cost
+  // false if the caller has already checked the instance with FLP_FeasibilityOracle (a reduced copy is checked anyway)
+  bool check_capacity = true;
+  bool polish = false;
+  unsigned long polish_interval = 0;
+  unsigned threads = 0;
+  int starts = 1;
+  unsigned keep_starts = 1;
+  double random_starts = 0.0, init_time_limit = 0.0;
+  double warm_temperature_ratio = 0.1; // of the start temperatures of SA and LNS, with a warm start
+  string checkpoint_file; // empty: no checkpoints (CSA, CSSA, CSKSA, and CSKSAtb only)
+  double checkpoint_interval = 60.0; // seconds
+  unsigned long lns_iterations = 100000;
+  int lns_max_removed = 30;
+  double lns_start_temperature = 100.0, lns_min_temperature = 1.0;
+  unsigned long ils_iterations = 10000;
+  int ils_kick_length = 1;
+  double ils_threshold = 0.0;
+  unsigned long hts_iterations = 100000;
+  int hts_samples = 100;
+  unsigned long hts_tenure = 1000;
+  unsigned hts_elite = 10;
+  unsigned long hts_restart = 5000;
+  // options of the runners in command line form, e.g. {"--CSKSA::cooling_rate", "0.994"}
+  vector<string> runner_arguments;
+};
+
+struct FLP_Result
+{ // the best solution and the figures reported by the command line program
+  FLP_Result(const FLP_Input& in) : output(in), init(in) {}
+  FLP_Output output, init;
+  CostType cost = 0, supply = 0, opening = 0, init_cost = 0, init_supply = 0, init_opening = 0;
+  double init_time = 0.0, time = 0.0;
+  bool consistent = false, cancelled = false;
+  unsigned seed = 0;
+  unsigned long long iterations = 0; // CSKSAtb
+  unsigned long moves = 0, sweeps = 0; // KPSD, CPSD, LNS, ILS
+  unsigned long tabu_hits = 0, elite_duplicates = 0, restarts = 0; // HTS
+  unsigned elite_size = 0;
+  double change_wasted_draws = 0.0, swap_wasted_draws = 0.0;
+  CostType lower_bound = 0; // with gap_threshold
+  double reduction_time = 0.0; // with reduce
+  int fixed_warehouses = 0, excluded_warehouses = 0, removed_preferred_pairs = 0, removed_neighbor_pairs = 0;
+  unsigned long long clopen_cache_lookups = 0; // with clopen_cache
+  double clopen_cache_hit_rate = 0.0;
+  unsigned polish_calls = 0, polish_improvements = 0; // with polish or polish_interval
+  double polish_time = 0.0;
+  int constructions = 1; // with starts
+  unsigned kept_starts = 1;
+  unsigned greedy_repairs = 0, greedy_restarts = 0;
+  unsigned checkpoints = 0; // written, with checkpoint_file
+  int repaired_stores = 0; // with Replan and WarmStart: stores placed again, -1 if the repair failed (and the construction was used)
+  // if not empty, no initial state could be built and there is no solution: "infeasible" (the capacities cannot
+  // cover the demands) or "stuck" (the greedy construction failed), with the JSON members that describe it
+  string error, error_details;
+};
+
+struct FLP_Engine; // the components of the search
+struct FLP_Checkpoint;
+class FLP_LagrangianBound;
+
+class FLP_Solver
+{ // the instance is reduced (if requested) on a private copy, so in is never modified; the progress callback
+  // receives the best cost periodically, and the search stops at the next check once *cancel is set
+  // (except KPSD and CPSD, which run a single descent); the generator of the helpers (FLP_Random) is seeded
+  // for the thread that builds the solver, so the runs are reproducible if Solve is called on that thread
+public:
+  FLP_Solver(const FLP_Input& in, const FLP_Options& options);
+  ~FLP_Solver();
+  bool ParseArguments(int argc, const char* argv[]); // all the options of the runners, checked (command line)
+  FLP_Result Solve(const FLP_Output* warm_start = nullptr, function<void(CostType)> progress = nullptr,
+                   const atomic<bool>* cancel = nullptr); // warm_start replaces the initial construction
+  // after deltas of the instance (FLP_Input::SetCapacity, ...), the solver built again on it continues from the
+  // solution of the previous round, repaired, instead of a new construction, for at most options.replan_timeout
+  // seconds of search
+  FLP_Result Replan(const FLP_Output& previous, function<void(CostType)> progress = nullptr,
+                    const atomic<bool>* cancel = nullptr);
+  // a previous solution, in either format of operator>>, is repaired (in O(S)) and used as the warm start;
+  // throws invalid_argument if it cannot be read
+  FLP_Result WarmStart(istream& is, function<void(CostType)> progress = nullptr, const atomic<bool>* cancel = nullptr);
+  // continues the annealing run saved in checkpoint (see FLP_Checkpoint.hh), with the same method and options;
+  // throws invalid_argument if the checkpoint is for another method, instance, or preprocessing of the instance
+  // (with reduce, the solver must be built with options.reduction_cost = checkpoint.reduction_cost)
+  FLP_Result Resume(const FLP_Checkpoint& checkpoint, function<void(CostType)> progress = nullptr,
+                    const atomic<bool>* cancel = nullptr);
+  void RunTester(const string& init_state = ""); // the interactive tester of EasyLocal
+  const FLP_Input& Input() const { return reduced ? *reduced : in; } // the instance searched
+  // the runners of EasyLocal share global state (the random generator and the parameters, also set by the
+  // construction of any solver): if false, constructions, destructions and Solve calls of concurrent
+  // solvers must be serialized; LNS, ILS, HTS, KPSD, and CPSD use only per-thread generators
+  bool ThreadSafe() const;
+private:
+  FLP_Result SolveRepaired(FLP_Output& st, bool rebuild, function<void(CostType)> progress, const atomic<bool>* cancel);
+  const FLP_Input& in;
+  FLP_Options options;
+  unique_ptr<FLP_Input> reduced;
+  unique_ptr<FLP_LagrangianBound> bound; // used by the reduction and by the gap_threshold stop
+  unique_ptr<FLP_Engine> engine;
+  unsigned seed; // the generators are reseeded during the runs that save checkpoints
+  const FLP_Checkpoint* resuming = nullptr; // during Resume
+  const FLP_Output* resuming_best = nullptr;
+  int reduction_cost; // the known cost used by the reduction (-1 if the instance is not reduced)
+  double reduction_time;
+  int fixed_warehouses, excluded_warehouses, removed_preferred_pairs, removed_neighbor_pairs;
+};
+
+FLP_Result FLP_Solve(const FLP_Input& in, const FLP_Options& options, const FLP_Output* warm_start = nullptr,
+                     function<void(CostType)> progress = nullptr, const atomic<bool>* cancel = nullptr);
+#endif